@@ -0,0 +1,235 @@
+#include "LPF_App.h"
+
+using namespace cv;
+using namespace std;
+
+namespace sequential
+{
+    Mat process(const Mat& image, const int kernal_size, const bool waitFlag) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Perform convolution on the input image using the filter kernel
+        Mat outputImage = seqLowPassFilter(image, kernal_size);
+
+        // Stop the timer
+        auto end_time = chrono::high_resolution_clock::now();
+
+        // Print the elapsed time in milliseconds
+        auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+        printf("Sequential Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+        fflush(stdout);
+
+        // Display the input and output images
+        imshow("Original image", image);
+        imshow("Sequential Output image", outputImage);
+        {
+            TraceScope scope("write");
+            imwrite("seqImage.png", outputImage);
+        }
+
+        // Wait for the user to press any key
+        if (waitFlag) {
+            waitKey(0);
+        }
+
+        // Return the output image
+        return outputImage;
+    }
+
+    Mat process(const Mat& image, const int kernal_size) {
+        // Perform convolution on the input image
+        return process(image, kernal_size, true);
+    }
+}
+
+namespace openmp
+{
+    Mat process(const Mat& image, const int kernal_size, const int num_of_threads, const bool waitFlag) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Perform convolution on the input image using the filter kernel
+        Mat outputImage = openMPLowPassFilter(image, kernal_size, num_of_threads);
+
+        // Stop the timer
+        auto end_time = chrono::high_resolution_clock::now();
+
+        // Print the elapsed time in milliseconds
+        auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+        printf("OpenMP Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+        fflush(stdout);
+
+        // Display the input and output images
+        imshow("Original image", image);
+        imshow("OpenMP Output image", outputImage);
+        {
+            TraceScope scope("write");
+            imwrite("OpenMPImage.png", outputImage);
+        }
+
+        // Wait for the user to press any key
+        if (waitFlag) {
+            waitKey(0);
+        }
+
+        // Return the output image
+        return outputImage;
+    }
+
+    Mat process(const Mat& image, const int kernal_size, const int num_of_threads) {
+        // Perform convolution on the input image
+        return process(image, kernal_size, num_of_threads, true);
+    }
+}
+
+namespace mpi
+{
+    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const bool waitFlag) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Perform convolution on the input image using the filter kernel
+        Mat outputImage = MPILowPassFilter(image, kernal_size, world_size, world_rank, collector);
+
+        if (world_rank == collector) {
+            // Print the elapsed time in milliseconds
+            auto end_time = chrono::high_resolution_clock::now();
+            auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+            printf("MPI Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+            fflush(stdout);
+
+            // Display the input and output images
+            imshow("Original image", image);
+            imshow("MPI Output image", outputImage);
+            {
+                TraceScope scope("write");
+                imwrite("mpiImage.png", outputImage);
+            }
+
+            // Wait for the user to press any key
+            if (waitFlag) {
+                waitKey(0);
+            }
+        }
+
+        // Return the output image
+        return outputImage;
+    }
+
+    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector) {
+        // Perform convolution on the input image
+        return process(image, kernal_size, world_size, world_rank, collector, true);
+    }
+
+    bool processFile(const String& inputPath, const String& outputPath, const int kernal_size, const int world_size, const int world_rank, const int collector) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Every process reads and writes its own rows of the files
+        bool result = MPIFileLowPassFilter(inputPath, outputPath, kernal_size, world_size, world_rank, collector);
+
+        if (world_rank == collector) {
+            if (!result) {
+                printf("Could not filter %s into %s with MPI-IO\n", inputPath.c_str(), outputPath.c_str());
+                fflush(stdout);
+                return false;
+            }
+
+            // Print the elapsed time in milliseconds
+            auto end_time = chrono::high_resolution_clock::now();
+            auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+            printf("MPI-IO Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+            fflush(stdout);
+        }
+
+        return result;
+    }
+}
+
+namespace hybrid
+{
+    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const int num_of_threads, const bool waitFlag) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Perform convolution on the input image using the filter kernel
+        Mat outputImage = hybridLowPassFilter(image, kernal_size, world_size, world_rank, collector, num_of_threads);
+
+        if (world_rank == collector) {
+            // Print the elapsed time in milliseconds
+            auto end_time = chrono::high_resolution_clock::now();
+            auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+            printf("Hybrid Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+            fflush(stdout);
+
+            // Display the input and output images
+            imshow("Original image", image);
+            imshow("Hybrid Output image", outputImage);
+            {
+                TraceScope scope("write");
+                imwrite("hybridImage.png", outputImage);
+            }
+
+            // Wait for the user to press any key
+            if (waitFlag) {
+                waitKey(0);
+            }
+        }
+
+        // Return the output image
+        return outputImage;
+    }
+
+    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const int num_of_threads) {
+        // Perform convolution on the input image
+        return process(image, kernal_size, world_size, world_rank, collector, num_of_threads, true);
+    }
+}
+
+namespace stream
+{
+    bool process(const String& inputPath, const String& outputPath, const int kernal_size, const int band_height, const int num_of_threads) {
+        // Start the timer
+        auto start_time = chrono::high_resolution_clock::now();
+
+        // Filter the input file band by band into the output file
+        bool result = streamLowPassFilter(inputPath, outputPath, kernal_size, band_height, num_of_threads);
+
+        // Stop the timer
+        auto end_time = chrono::high_resolution_clock::now();
+
+        if (!result) {
+            printf("Could not stream %s into %s\n", inputPath.c_str(), outputPath.c_str());
+            fflush(stdout);
+            return false;
+        }
+
+        // Print the elapsed time in milliseconds
+        auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+        printf("Streaming Elapsed time: %lld milliseconds\n", (long long)elapsed_time.count());
+        fflush(stdout);
+
+        return true;
+    }
+}
+
+namespace batch
+{
+    BatchStats process(FrameSource& source, FrameSink* sink, const int kernal_size, const int num_of_threads) {
+        // Four buffers let the decoder run a couple of frames ahead of the filter and the encoder a couple behind it
+        BatchStats stats = batchLowPassFilter(source, sink, kernal_size, num_of_threads, 4);
+
+        // Print the throughput
+        printf("Batch: %lld frames in %lld milliseconds (%.1f fps)\n", stats.frames, (long long)(stats.seconds * 1000), stats.fps);
+        if (stats.failedWrites > 0) {
+            printf("Batch: %lld frames could not be written\n", stats.failedWrites);
+        }
+        if (!stats.error.empty()) {
+            printf("Batch stopped early: %s\n", stats.error.c_str());
+        }
+        fflush(stdout);
+
+        return stats;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <chrono>
+
+#include "LPF_Sequential.h"
+#include "LPF_OpenMP.h"
+#include "LPF_MPI.h"
+#include "LPF_Hybrid.h"
+#include "LPF_Stream.h"
+#include "LPF_Batch.h"
+
+// The methods of the interactive program. Each one filters with one backend, prints how long the filter took,
+// and on the collector shows the input and output images and writes the output file. The filters themselves
+// have no window or file output.
+namespace sequential
+{
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const bool waitFlag);
+	cv::Mat process(const cv::Mat& image, const int kernal_size);
+}
+
+namespace openmp
+{
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int num_of_threads, const bool waitFlag);
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int num_of_threads);
+}
+
+namespace mpi
+{
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const bool waitFlag);
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector);
+	bool processFile(const cv::String& inputPath, const cv::String& outputPath, const int kernal_size, const int world_size, const int world_rank, const int collector);
+}
+
+namespace hybrid
+{
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const int num_of_threads, const bool waitFlag);
+	cv::Mat process(const cv::Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const int num_of_threads);
+}
+
+namespace stream
+{
+	bool process(const cv::String& inputPath, const cv::String& outputPath, const int kernal_size, const int band_height, const int num_of_threads);
+}
+
+namespace batch
+{
+	BatchStats process(FrameSource& source, FrameSink* sink, const int kernal_size, const int num_of_threads);
+}
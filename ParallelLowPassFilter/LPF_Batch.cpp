@@ -0,0 +1,182 @@
+#include "LPF_Batch.h"
+#include <cctype>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+
+DirectoryFrameSource::DirectoryFrameSource(const String& directory) : nextFile(0) {
+    // glob lists the files in name order, which is the frame order of numbered frames
+    vector<String> paths;
+    glob(directory, paths, false);
+    for (const String& path : paths) {
+        String extension = path.substr(path.find_last_of('.') + 1);
+        for (char& c : extension) {
+            c = (char)tolower(c);
+        }
+        if (extension == "pgm" || extension == "pfm" || extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "bmp" || extension == "tif" || extension == "tiff") {
+            files.push_back(path);
+        }
+    }
+}
+
+bool DirectoryFrameSource::read(Mat& frame) {
+    while (nextFile < files.size()) {
+        const String& path = files[nextFile++];
+
+        // PGM and PFM pixels are read straight into the buffer without decoding
+        ifstream file(path, ios::binary);
+        ImageFileHeader header;
+        if (file && readImageHeader(file, header)) {
+            frame.create(header.rows, header.cols, header.type);
+            if (readImageRows(file, header, 0, frame)) {
+                // PFM stores its rows bottom to top and its colours as RGB, turn them into imread's order
+                if (header.format == FORMAT_PFM) {
+                    flip(frame, frame, 0);
+                    for (int y = 0; y < frame.rows && frame.channels() == 3; y++) {
+                        Vec3f* pixel = frame.ptr<Vec3f>(y);
+                        for (int x = 0; x < frame.cols; x++) {
+                            swap(pixel[x][0], pixel[x][2]);
+                        }
+                    }
+                }
+                return true;
+            }
+            continue;
+        }
+        file.close();
+
+        Mat image = imread(path, IMREAD_UNCHANGED);
+        if (!image.empty()) {
+            image.copyTo(frame);
+            return true;
+        }
+    }
+    return false;
+}
+
+VideoFrameSource::VideoFrameSource(const String& path) : capture(path) {
+}
+
+bool VideoFrameSource::read(Mat& frame) {
+    // The capture decodes straight into the frame buffer, which it reuses while the size stays the same
+    return capture.read(frame) && !frame.empty();
+}
+
+RawFrameSource::RawFrameSource(const String& path, const int rows, const int cols, const int type) : file(path, ios::binary), frameRows(rows), frameCols(cols), frameType(type) {
+    CV_Assert(rows > 0 && cols > 0);
+}
+
+bool RawFrameSource::read(Mat& frame) {
+    frame.create(frameRows, frameCols, frameType);
+    return (bool)file.read((char*)frame.data, (streamsize)frame.total() * frame.elemSize());
+}
+
+ImageSequenceFrameSink::ImageSequenceFrameSink(const String& pattern) : namePattern(pattern), frameNumber(0) {
+}
+
+bool ImageSequenceFrameSink::write(const Mat& frame) {
+    return imwrite(format(namePattern.c_str(), frameNumber++), frame);
+}
+
+VideoFrameSink::VideoFrameSink(const String& path, const int fourcc, const double fps) : videoPath(path), videoFourcc(fourcc), videoFps(fps) {
+}
+
+bool VideoFrameSink::write(const Mat& frame) {
+    if (!writer.isOpened() && !writer.open(videoPath, videoFourcc, videoFps, frame.size(), frame.channels() > 1)) {
+        return false;
+    }
+    writer.write(frame);
+    return true;
+}
+
+RawFrameSink::RawFrameSink(const String& path) : file(path, ios::binary) {
+}
+
+bool RawFrameSink::write(const Mat& frame) {
+    for (int i = 0; i < frame.rows; i++) {
+        file.write((const char*)frame.ptr(i), frame.cols * frame.elemSize());
+    }
+    return (bool)file;
+}
+
+BatchStats batchLowPassFilter(FrameSource& source, FrameSink* sink, const int kernelSize, const int num_of_threads, const int poolSize) {
+    CV_Assert(poolSize > 0);
+
+    // The buffers go round in a loop: free input buffer -> decode -> filter -> free input buffer, and
+    // free output buffer -> filter -> encode -> free output buffer. The queues hold buffer indices.
+    vector<Mat> inputBuffers(poolSize), outputBuffers(poolSize);
+    BoundedQueue<int> freeInputs(poolSize), freeOutputs(poolSize), decodedFrames(poolSize), filteredFrames(poolSize);
+    for (int i = 0; i < poolSize; i++) {
+        freeInputs.push(i);
+        freeOutputs.push(i);
+    }
+
+    BatchStats stats;
+    auto start_time = chrono::high_resolution_clock::now();
+
+    thread decoder([&] {
+        int buffer;
+        while (freeInputs.pop(buffer)) {
+            TraceScope scope("decode");
+            if (!source.read(inputBuffers[buffer])) {
+                break;
+            }
+            scope.end();
+            if (!decodedFrames.push(buffer)) {
+                break;
+            }
+        }
+        decodedFrames.close();
+    });
+
+    thread encoder([&] {
+        int buffer;
+        while (filteredFrames.pop(buffer)) {
+            if (sink != nullptr) {
+                TraceScope scope("encode");
+                if (!sink->write(outputBuffers[buffer])) {
+                    stats.failedWrites++;
+                }
+            }
+            freeOutputs.push(buffer);
+        }
+    });
+
+    // Filter on this thread with the OpenMP tiles, the output buffer only reallocates when the frame size changes.
+    // On an error every queue is closed, so the other stages stop waiting and can be joined.
+    int input, output;
+    try {
+        while (decodedFrames.pop(input)) {
+            const Mat& frame = inputBuffers[input];
+            if (frame.empty() || !isBoxFilterType(frame.type())) {
+                stats.error = format("frame %lld has a pixel type the filter does not support", stats.frames);
+                break;
+            }
+            freeOutputs.pop(output);
+            outputBuffers[output].create(frame.size(), frame.type());
+            TraceScope scope("filter");
+            openMPLowPassFilter(frame, outputBuffers[output], kernelSize, num_of_threads);
+            scope.end();
+            freeInputs.push(input);
+            filteredFrames.push(output);
+            stats.frames++;
+        }
+    }
+    catch (const exception& e) {
+        stats.error = e.what();
+    }
+    if (!stats.error.empty()) {
+        freeInputs.close();
+        decodedFrames.close();
+    }
+    filteredFrames.close();
+
+    decoder.join();
+    encoder.join();
+
+    auto end_time = chrono::high_resolution_clock::now();
+    stats.seconds = chrono::duration<double>(end_time - start_time).count();
+    stats.fps = stats.seconds > 0 ? stats.frames / stats.seconds : 0;
+    return stats;
+}
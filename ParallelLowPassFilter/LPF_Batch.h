@@ -0,0 +1,180 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/videoio/videoio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "LPF_ImageIO.h"
+#include "LPF_OpenMP.h"
+
+// Frames to filter. read() decodes the next frame into a buffer that is reused from frame to frame, so
+// it should only reallocate it when the frame size changes. It returns false at the end of the frames.
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+	virtual bool isOpened() const = 0;
+	virtual bool read(cv::Mat& frame) = 0;
+};
+
+// Where the filtered frames go, in the order they were read
+class FrameSink
+{
+public:
+	virtual ~FrameSink() {}
+	virtual bool isOpened() const = 0;
+	virtual bool write(const cv::Mat& frame) = 0;
+};
+
+// Every image file of a directory in name order, with the channels and bit depth of the file. PGM and PFM files
+// are read straight into the frame buffer, PFM frames then turned into imread's row and channel order, other
+// formats go through imread.
+class DirectoryFrameSource : public FrameSource
+{
+public:
+	explicit DirectoryFrameSource(const cv::String& directory);
+	bool isOpened() const override { return !files.empty(); }
+	bool read(cv::Mat& frame) override;
+
+private:
+	std::vector<cv::String> files;
+	size_t nextFile;
+};
+
+// The frames of a video file or camera, in the color format the capture decodes to
+class VideoFrameSource : public FrameSource
+{
+public:
+	explicit VideoFrameSource(const cv::String& path);
+	bool isOpened() const override { return capture.isOpened(); }
+	bool read(cv::Mat& frame) override;
+
+private:
+	cv::VideoCapture capture;
+};
+
+// Headerless frames of rows x cols pixels of the given type one after the other, for example from a camera pipe
+class RawFrameSource : public FrameSource
+{
+public:
+	RawFrameSource(const cv::String& path, const int rows, const int cols, const int type = CV_8UC1);
+	bool isOpened() const override { return (bool)file; }
+	bool read(cv::Mat& frame) override;
+
+private:
+	std::ifstream file;
+	int frameRows;
+	int frameCols;
+	int frameType;
+};
+
+// One image file per frame, the name is a printf pattern of the frame number such as "frame_%06d.png"
+class ImageSequenceFrameSink : public FrameSink
+{
+public:
+	explicit ImageSequenceFrameSink(const cv::String& pattern);
+	bool isOpened() const override { return !namePattern.empty(); }
+	bool write(const cv::Mat& frame) override;
+
+private:
+	cv::String namePattern;
+	int frameNumber;
+};
+
+// A video file, opened when the first frame gives its size and whether it is in color
+class VideoFrameSink : public FrameSink
+{
+public:
+	VideoFrameSink(const cv::String& path, const int fourcc, const double fps);
+	bool isOpened() const override { return !videoPath.empty(); }
+	bool write(const cv::Mat& frame) override;
+
+private:
+	cv::VideoWriter writer;
+	cv::String videoPath;
+	int videoFourcc;
+	double videoFps;
+};
+
+// Headerless frames one after the other
+class RawFrameSink : public FrameSink
+{
+public:
+	explicit RawFrameSink(const cv::String& path);
+	bool isOpened() const override { return (bool)file; }
+	bool write(const cv::Mat& frame) override;
+
+private:
+	std::ofstream file;
+};
+
+// A blocking first-in first-out queue of at most capacity items that the pipeline stages hand frames over with.
+// pop() returns false once the queue is closed and empty, push() drops the item and returns false once it is closed.
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(const size_t capacity) : maxSize(capacity), closed(false) {}
+
+	bool push(const T& item) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		notFull.wait(lock, [this] { return items.size() < maxSize || closed; });
+		if (closed) {
+			return false;
+		}
+		items.push_back(item);
+		notEmpty.notify_one();
+		return true;
+	}
+
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+		if (items.empty()) {
+			return false;
+		}
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+
+private:
+	size_t maxSize;
+	bool closed;
+	std::deque<T> items;
+	std::mutex queueMutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+
+struct BatchStats
+{
+	long long frames = 0;
+	long long failedWrites = 0;    // Frames the sink could not write
+	double seconds = 0;
+	double fps = 0;
+	cv::String error;              // Why the pipeline stopped before the end of the source, empty when it did not
+};
+
+// Filter every frame of the source into the sink (which may be null to only measure the filter). Decoding,
+// filtering and encoding run on their own threads and overlap, handing frames over through bounded queues.
+// A pool of poolSize input and poolSize output buffers is reused for every frame, so once the first frames
+// have sized the buffers, frames of the same size are filtered without allocating any image memory.
+// A frame of a type the box filter does not take, or a failing filter, stops the pipeline after the frames before it.
+BatchStats batchLowPassFilter(FrameSource& source, FrameSink* sink, const int kernelSize, const int num_of_threads, const int poolSize);
@@ -0,0 +1,522 @@
+#include "LPF_Benchmark.h"
+#include "LPF_Verify.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string.h>
+
+using namespace cv;
+using namespace std;
+
+// Split a comma separated list, empty items are dropped
+static vector<String> splitList(const String& text) {
+    vector<String> items;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == String::npos) {
+            end = text.size();
+        }
+        if (end > begin) {
+            items.push_back(text.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return items;
+}
+
+static bool parseInt(const String& text, int& value, const int minimum = 1) {
+    char* end;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || parsed < minimum || parsed > INT_MAX) {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
+
+static bool parseIntList(const String& text, vector<int>& values) {
+    values.clear();
+    for (const String& item : splitList(text)) {
+        int value;
+        if (!parseInt(item, value)) {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+static bool parseSizeList(const String& text, vector<Size>& sizes) {
+    sizes.clear();
+    for (const String& item : splitList(text)) {
+        size_t separator = item.find('x');
+        Size size;
+        if (separator == String::npos || !parseInt(item.substr(0, separator), size.width) || !parseInt(item.substr(separator + 1), size.height)) {
+            return false;
+        }
+        sizes.push_back(size);
+    }
+    return !sizes.empty();
+}
+
+static const struct { const char* name; int type; } benchmarkTypes[] = {
+    { "8UC1", CV_8UC1 }, { "8UC3", CV_8UC3 }, { "8UC4", CV_8UC4 },
+    { "16UC1", CV_16UC1 }, { "16UC3", CV_16UC3 }, { "16UC4", CV_16UC4 },
+    { "32FC1", CV_32FC1 }, { "32FC3", CV_32FC3 }, { "32FC4", CV_32FC4 }
+};
+
+const char* benchmarkTypeName(const int type) {
+    for (const auto& entry : benchmarkTypes) {
+        if (entry.type == type) {
+            return entry.name;
+        }
+    }
+    return "other";
+}
+
+static bool parseTypeList(const String& text, vector<int>& types) {
+    types.clear();
+    for (const String& item : splitList(text)) {
+        bool found = false;
+        for (const auto& entry : benchmarkTypes) {
+            if (item == entry.name) {
+                types.push_back(entry.type);
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return !types.empty();
+}
+
+bool parseBenchmarkOptions(int argc, char** argv, BenchmarkOptions& options, String& error) {
+    for (int i = 1; i < argc; i++) {
+        String flag = argv[i];
+        if (i + 1 >= argc) {
+            error = "Missing value for " + flag;
+            return false;
+        }
+        String value = argv[++i];
+
+        bool valid = true;
+        if (flag == "--backend") {
+            options.backends = splitList(value);
+            for (const String& backend : options.backends) {
+                valid = valid && (backend == "seq" || backend == "openmp" || backend == "numa" || backend == "mpi" || backend == "balanced" || backend == "hybrid" ||
+                    backend == "incremental" || backend == "stream" || backend == "mpifile" || backend == "batch");
+            }
+            valid = valid && !options.backends.empty();
+        }
+        else if (flag == "--kernel") {
+            valid = parseIntList(value, options.kernelSizes);
+            for (int kernelSize : options.kernelSizes) {
+                valid = valid && kernelSize % 2 == 1;
+            }
+        }
+        else if (flag == "--passes") {
+            valid = parseIntList(value, options.passCounts);
+        }
+        else if (flag == "--threads") {
+            valid = parseIntList(value, options.threadCounts);
+        }
+        else if (flag == "--nodes") {
+            valid = parseIntList(value, options.nodeCounts);
+        }
+        else if (flag == "--ranks") {
+            valid = parseIntList(value, options.rankCounts);
+        }
+        else if (flag == "--size") {
+            valid = parseSizeList(value, options.imageSizes);
+        }
+        else if (flag == "--type") {
+            valid = parseTypeList(value, options.imageTypes);
+        }
+        else if (flag == "--input") {
+            options.inputPath = value;
+        }
+        else if (flag == "--warmup") {
+            valid = parseInt(value, options.warmup, 0);
+        }
+        else if (flag == "--reps") {
+            valid = parseInt(value, options.repetitions);
+        }
+        else if (flag == "--format") {
+            options.format = value;
+            valid = value == "json" || value == "csv";
+        }
+        else if (flag == "--output") {
+            options.outputPath = value;
+        }
+        else if (flag == "--trace") {
+            options.tracePath = value;
+        }
+        else if (flag == "--counters") {
+            options.hardwareCounters = value == "on";
+            valid = value == "on" || value == "off";
+        }
+        else if (flag == "--verify") {
+            options.verify = value;
+            valid = value == "on" || value == "off" || value == "only";
+        }
+        else if (flag == "--baseline") {
+            options.baselinePath = value;
+        }
+        else if (flag == "--tolerance") {
+            char* end;
+            options.tolerance = strtod(value.c_str(), &end);
+            valid = !value.empty() && *end == '\0' && options.tolerance >= 0;
+        }
+        else {
+            error = "Unknown option " + flag;
+            return false;
+        }
+
+        if (!valid) {
+            error = "Invalid value " + value + " for " + flag;
+            return false;
+        }
+    }
+    return true;
+}
+
+void printBenchmarkUsage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --backend LIST   seq,openmp,numa,mpi,balanced,hybrid (default: all), and for --verify\n");
+    printf("                   also incremental,stream,mpifile,batch\n");
+    printf("  --kernel LIST    odd kernel sizes (default: 3,5,29)\n");
+    printf("  --passes LIST    box passes per call, fused into one call (default: 1)\n");
+    printf("  --threads LIST   OpenMP thread counts (default: omp_get_max_threads())\n");
+    printf("  --nodes LIST     NUMA nodes the numa backend pins its threads to (default: all, %d here)\n", numaNodeCount());
+    printf("  --ranks LIST     MPI process counts, at most the size of mpirun -n (default: all)\n");
+    printf("  --size LIST      synthetic image sizes as WIDTHxHEIGHT (default: 1920x1080)\n");
+    printf("  --type LIST      synthetic pixel types: 8UC1,8UC3,8UC4,16UC1,16UC3,16UC4,32FC1,32FC3,32FC4 (default: 8UC1)\n");
+    printf("  --input PATH     filter an image file as stored instead of synthetic ones\n");
+    printf("  --warmup N       untimed runs before measuring (default: 2)\n");
+    printf("  --reps N         timed runs (default: 10)\n");
+    printf("  --format FORMAT  json or csv (default: json)\n");
+    printf("  --output PATH    write the results to a file instead of standard output\n");
+    printf("  --trace PATH     write a Chrome trace of the phases of every run on every rank and thread\n");
+    printf("  --counters MODE  on or off, count cycles and instructions per phase in the trace on Linux (default: off)\n");
+    printf("  --verify MODE    on: check every backend against a reference before measuring, only: check and stop, off (default: off)\n");
+    printf("  --baseline PATH  compare the throughput with a CSV of an earlier run, fail on a regression\n");
+    printf("  --tolerance PCT  percent of the baseline throughput a configuration may lose (default: 10)\n");
+    fflush(stdout);
+}
+
+// Time warmup + repetitions runs in microseconds. With a communicator, all its processes start every run together.
+static vector<double> timeRuns(const BenchmarkOptions& options, const MPI_Comm comm, const function<void()>& run) {
+    vector<double> times;
+    for (int i = 0; i < options.warmup + options.repetitions; i++) {
+        if (comm != MPI_COMM_NULL) {
+            MPI_Barrier(comm);
+        }
+        TraceScope scope(i < options.warmup ? "warmup run" : "run");
+        auto start_time = chrono::high_resolution_clock::now();
+        run();
+        auto end_time = chrono::high_resolution_clock::now();
+        scope.end();
+        if (i >= options.warmup) {
+            times.push_back(chrono::duration<double, micro>(end_time - start_time).count());
+        }
+    }
+    return times;
+}
+
+static BenchmarkResult summarize(const String& backend, const Mat& image, const int kernelSize, const int passes, const int threads, const int ranks, vector<double> times, const double sequentialMedian, const int nodes = 0) {
+    sort(times.begin(), times.end());
+
+    BenchmarkResult result;
+    result.backend = backend;
+    result.width = image.cols;
+    result.height = image.rows;
+    result.type = image.type();
+    result.kernelSize = kernelSize;
+    result.passes = passes;
+    result.threads = threads;
+    result.nodes = nodes;
+    result.ranks = ranks;
+    result.repetitions = (int)times.size();
+    result.minMicroseconds = times.front();
+    result.medianMicroseconds = times.size() % 2 == 1 ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    result.p99Microseconds = times[(size_t)ceil(0.99 * times.size()) - 1];
+
+    // Pixels per microsecond are megapixels per second, every pass counts
+    result.megapixelsPerSecond = (double)image.total() * passes / result.medianMicroseconds;
+    result.efficiency = sequentialMedian / (result.medianMicroseconds * threads * ranks);
+    return result;
+}
+
+MPI_Comm splitRanks(const int ranks, const int world_size, const int world_rank, const int collector) {
+    int order = (world_rank - collector + world_size) % world_size;
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, order < ranks ? 0 : MPI_UNDEFINED, order, &comm);
+    return comm;
+}
+
+vector<BenchmarkResult> runBenchmark(const BenchmarkOptions& options, const int world_size, const int world_rank, const int collector) {
+    vector<BenchmarkResult> results;
+    vector<int> threadCounts = options.threadCounts.empty() ? vector<int>{ omp_get_max_threads() } : options.threadCounts;
+    // More nodes than the machine has run on all of them, once
+    vector<int> nodeCounts;
+    for (int nodes : options.nodeCounts.empty() ? vector<int>{ numaNodeCount() } : options.nodeCounts) {
+        nodes = min(max(nodes, 1), numaNodeCount());
+        if (find(nodeCounts.begin(), nodeCounts.end(), nodes) == nodeCounts.end()) {
+            nodeCounts.push_back(nodes);
+        }
+    }
+    vector<int> rankCounts = options.rankCounts.empty() ? vector<int>{ world_size } : options.rankCounts;
+
+    // Every process builds the image, the MPI filters need its size everywhere
+    vector<Mat> images;
+    if (!options.inputPath.empty()) {
+        TraceScope scope("load");
+        images.push_back(imread(options.inputPath, IMREAD_UNCHANGED));
+    }
+    else {
+        for (const Size& size : options.imageSizes) {
+            for (int type : options.imageTypes) {
+                Mat image(size, type);
+                theRNG() = RNG(0x12345678);
+                randu(image, Scalar::all(0), Scalar::all(CV_MAT_DEPTH(type) == CV_8U ? 256 : CV_MAT_DEPTH(type) == CV_16U ? 65536 : 1));
+                images.push_back(image);
+            }
+        }
+    }
+
+    for (const Mat& image : images) {
+        if (image.empty() || !isBoxFilterType(image.type())) {
+            continue;
+        }
+        Mat outputImage(image.size(), image.type());
+
+        for (int kernelSize : options.kernelSizes) {
+            const FilterKernel kernel = FilterKernel::box(kernelSize);
+            for (int passes : options.passCounts) {
+                // The sequential median is the baseline of the parallel efficiency, so it is measured even when not reported
+                double sequentialMedian = 0;
+                if (world_rank == collector) {
+                    BenchmarkResult sequential = summarize("seq", image, kernelSize, passes, 1, 1,
+                        timeRuns(options, MPI_COMM_NULL, [&] { seqMultiPassLowPassFilter(image, outputImage, kernel, passes); }), 0);
+                    sequentialMedian = sequential.medianMicroseconds;
+                    sequential.efficiency = 1;
+                    if (find(options.backends.begin(), options.backends.end(), "seq") != options.backends.end()) {
+                        results.push_back(sequential);
+                    }
+                }
+
+                for (const String& backend : options.backends) {
+                    if (backend == "openmp" && world_rank == collector) {
+                        for (int threads : threadCounts) {
+                            results.push_back(summarize(backend, image, kernelSize, passes, threads, 1,
+                                timeRuns(options, MPI_COMM_NULL, [&] { openMPMultiPassLowPassFilter(image, outputImage, kernel, passes, threads); }), sequentialMedian));
+                        }
+                    }
+                    else if (backend == "numa" && world_rank == collector) {
+                        // Both images are placed band by band before timing, like a pipeline that keeps its buffers
+                        for (int threads : threadCounts) {
+                            for (int nodes : nodeCounts) {
+                                const Mat numaInput = numaCopy(image, threads, nodes);
+                                Mat numaOutput = numaImage(image.size(), image.type(), threads, nodes);
+                                results.push_back(summarize(backend, image, kernelSize, passes, threads, 1,
+                                    timeRuns(options, MPI_COMM_NULL, [&] { numaLowPassFilter(numaInput, numaOutput, kernel, passes, threads, nodes); }), sequentialMedian, nodes));
+                            }
+                        }
+                    }
+                    else if (backend == "mpi" || backend == "balanced" || backend == "hybrid") {
+                        for (int ranks : rankCounts) {
+                            ranks = min(ranks, world_size);
+                            MPI_Comm comm = splitRanks(ranks, world_size, world_rank, collector);
+                            if (comm == MPI_COMM_NULL) {
+                                continue;
+                            }
+                            int rank;
+                            MPI_Comm_rank(comm, &rank);
+
+                            // The pure MPI backends are single threaded on every process. The balanced one adapts its row
+                            // blocks to the speed of every process during the warmup runs.
+                            vector<int> backendThreads = backend == "hybrid" ? threadCounts : vector<int>{ 1 };
+                            for (int threads : backendThreads) {
+                                BalancedMPILowPassFilter balancedFilter(ranks, rank, 0, comm);
+                                vector<double> times = timeRuns(options, comm, [&] {
+                                    if (backend == "mpi") {
+                                        MPIMultiPassLowPassFilter(image, outputImage, kernel, passes, ranks, rank, 0, comm);
+                                    }
+                                    else if (backend == "balanced") {
+                                        balancedFilter.filter(image, outputImage, kernel, passes);
+                                    }
+                                    else {
+                                        hybridMultiPassLowPassFilter(image, outputImage, kernel, passes, ranks, rank, 0, threads, comm);
+                                    }
+                                });
+                                if (rank == 0) {
+                                    results.push_back(summarize(backend, image, kernelSize, passes, threads, ranks, times, sequentialMedian));
+                                    if (backend == "balanced") {
+                                        results.back().imbalance = balancedFilter.imbalance();
+                                    }
+                                }
+                            }
+                            MPI_Comm_free(&comm);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+void writeBenchmarkResults(ostream& output, const vector<BenchmarkResult>& results, const String& format) {
+    if (format == "csv") {
+        output << "backend,width,height,type,kernel,passes,threads,nodes,ranks,reps,min_us,median_us,p99_us,mpixels_per_s,efficiency,imbalance\n";
+        for (const BenchmarkResult& result : results) {
+            output << result.backend << "," << result.width << "," << result.height << "," << benchmarkTypeName(result.type) << "," << result.kernelSize << "," << result.passes << ","
+                << result.threads << "," << result.nodes << "," << result.ranks << "," << result.repetitions << ","
+                << result.minMicroseconds << "," << result.medianMicroseconds << "," << result.p99Microseconds << ","
+                << result.megapixelsPerSecond << "," << result.efficiency << "," << result.imbalance << "\n";
+        }
+        return;
+    }
+
+    output << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        output << "  {\"backend\": \"" << result.backend << "\", \"width\": " << result.width << ", \"height\": " << result.height
+            << ", \"type\": \"" << benchmarkTypeName(result.type) << "\", \"kernel\": " << result.kernelSize << ", \"passes\": " << result.passes << ", \"threads\": " << result.threads << ", \"nodes\": " << result.nodes << ", \"ranks\": " << result.ranks
+            << ", \"reps\": " << result.repetitions << ", \"min_us\": " << result.minMicroseconds
+            << ", \"median_us\": " << result.medianMicroseconds << ", \"p99_us\": " << result.p99Microseconds
+            << ", \"mpixels_per_s\": " << result.megapixelsPerSecond << ", \"efficiency\": " << result.efficiency << ", \"imbalance\": " << result.imbalance << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    output << "]\n";
+}
+
+// The configuration of a result, the same in the CSV and in memory
+static String configurationKey(const String& backend, const String& width, const String& height, const String& type, const String& kernel, const String& passes, const String& threads, const String& nodes, const String& ranks) {
+    return backend + " " + width + "x" + height + " " + type + " kernel " + kernel + " passes " + passes + " threads " + threads + " nodes " + nodes + " ranks " + ranks;
+}
+
+int compareWithBaseline(const vector<BenchmarkResult>& results, const String& baselinePath, const double tolerance) {
+    ifstream baseline(baselinePath);
+    string line;
+    if (!baseline || !getline(baseline, line)) {
+        return -1;
+    }
+
+    // Find the columns by name, so baselines of older versions with fewer columns still work
+    map<string, size_t> columns;
+    vector<String> header = splitList(line);
+    for (size_t i = 0; i < header.size(); i++) {
+        columns[header[i]] = i;
+    }
+    const char* needed[] = { "backend", "width", "height", "type", "kernel", "passes", "threads", "ranks", "mpixels_per_s" };
+    for (const char* column : needed) {
+        if (columns.count(column) == 0) {
+            return -1;
+        }
+    }
+
+    map<String, double> baselineThroughput;
+    while (getline(baseline, line)) {
+        vector<String> fields = splitList(line);
+        if (fields.size() < header.size()) {
+            continue;
+        }
+        // Baselines from before the NUMA backend have no nodes column, none of their threads were pinned
+        const String nodes = columns.count("nodes") != 0 ? fields[columns["nodes"]] : String("0");
+        baselineThroughput[configurationKey(fields[columns["backend"]], fields[columns["width"]], fields[columns["height"]], fields[columns["type"]],
+            fields[columns["kernel"]], fields[columns["passes"]], fields[columns["threads"]], nodes, fields[columns["ranks"]])] = atof(fields[columns["mpixels_per_s"]].c_str());
+    }
+
+    int compared = 0, regressions = 0;
+    for (const BenchmarkResult& result : results) {
+        const String key = configurationKey(result.backend, to_string(result.width), to_string(result.height), benchmarkTypeName(result.type),
+            to_string(result.kernelSize), to_string(result.passes), to_string(result.threads), to_string(result.nodes), to_string(result.ranks));
+        auto found = baselineThroughput.find(key);
+        if (found == baselineThroughput.end() || found->second <= 0) {
+            continue;
+        }
+        compared++;
+        const double change = 100 * (result.megapixelsPerSecond / found->second - 1);
+        if (change < -tolerance) {
+            regressions++;
+            printf("REGRESSION %s: %.1f megapixels/s against %.1f in the baseline (%.1f%%)\n", key.c_str(), result.megapixelsPerSecond, found->second, change);
+        }
+    }
+    printf("Compared %d configurations with %s, %d lost more than %g%%\n", compared, baselinePath.c_str(), regressions, tolerance);
+    fflush(stdout);
+    return regressions;
+}
+
+int benchmarkMain(int argc, char** argv, const int world_size, const int world_rank, const int collector) {
+    BenchmarkOptions options;
+    String error;
+    if (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+        if (world_rank == collector) {
+            printBenchmarkUsage(argv[0]);
+        }
+        return 0;
+    }
+    if (!parseBenchmarkOptions(argc, argv, options, error)) {
+        if (world_rank == collector) {
+            printf("%s\n", error.c_str());
+            printBenchmarkUsage(argv[0]);
+        }
+        return 1;
+    }
+
+    if (options.verify != "off") {
+        const int failures = verifyBackends(options, world_size, world_rank, collector);
+        if (failures > 0 || options.verify == "only") {
+            return failures > 0 ? 1 : 0;
+        }
+    }
+
+    if (!options.tracePath.empty()) {
+        startTrace(options.hardwareCounters);
+    }
+    vector<BenchmarkResult> results = runBenchmark(options, world_size, world_rank, collector);
+    if (!options.tracePath.empty()) {
+        stopTrace();
+        if (!writeTrace(options.tracePath, world_size, world_rank, collector) && world_rank == collector) {
+            printf("Could not write the trace to %s\n", options.tracePath.c_str());
+            fflush(stdout);
+        }
+    }
+    if (world_rank != collector) {
+        return 0;
+    }
+    if (results.empty()) {
+        printf("Nothing was measured, check the input image and the options\n");
+        fflush(stdout);
+        return 1;
+    }
+
+    bool written = true;
+    if (options.outputPath.empty()) {
+        writeBenchmarkResults(cout, results, options.format);
+        cout.flush();
+    }
+    else {
+        ofstream output(options.outputPath);
+        writeBenchmarkResults(output, results, options.format);
+        written = (bool)output;
+    }
+
+    if (!options.baselinePath.empty()) {
+        const int regressions = compareWithBaseline(results, options.baselinePath, options.tolerance);
+        if (regressions < 0) {
+            printf("Could not read the baseline %s\n", options.baselinePath.c_str());
+            fflush(stdout);
+        }
+        if (regressions != 0) {
+            return 1;
+        }
+    }
+    return written ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <chrono>
+#include <vector>
+#include <mpi.h>
+
+#include "LPF_Sequential.h"
+#include "LPF_OpenMP.h"
+#include "LPF_NUMA.h"
+#include "LPF_MPI.h"
+#include "LPF_Hybrid.h"
+#include "LPF_Trace.h"
+
+// What to measure. Every combination of backend, image size, kernel size, pass count, thread count, NUMA node count
+// and rank count is timed warmup + repetitions times on the same image.
+struct BenchmarkOptions
+{
+	std::vector<cv::String> backends = { "seq", "openmp", "numa", "mpi", "balanced", "hybrid" };
+	std::vector<int> kernelSizes = { 3, 5, 29 };
+	std::vector<int> passCounts = { 1 };    // Box passes fused into one call
+	std::vector<int> threadCounts;          // Defaults to omp_get_max_threads()
+	std::vector<int> nodeCounts;            // NUMA nodes the numa backend spreads its threads over, defaults to all
+	std::vector<int> rankCounts;            // Defaults to the size of MPI_COMM_WORLD
+	std::vector<cv::Size> imageSizes = { cv::Size(1920, 1080) };
+	std::vector<int> imageTypes = { CV_8UC1 };  // Pixel types of the synthetic images
+	cv::String inputPath;                  // An image to use instead of the synthetic ones, as stored in the file
+	int warmup = 2;
+	int repetitions = 10;
+	cv::String format = "json";            // json or csv
+	cv::String outputPath;                 // Standard output when empty
+	cv::String tracePath;                  // A Chrome trace of every phase of every run, none when empty
+	bool hardwareCounters = false;     // Count cycles and instructions in the trace
+	cv::String verify = "off";             // on: check every backend with LPF_Verify first, only: check and stop
+	cv::String baselinePath;               // A CSV of an earlier run to compare the throughput with
+	double tolerance = 10;                 // Percent of the baseline throughput a configuration may lose
+};
+
+struct BenchmarkResult
+{
+	cv::String backend;
+	int width = 0;
+	int height = 0;
+	int type = CV_8UC1;
+	int kernelSize = 0;
+	int passes = 1;
+	int threads = 1;
+	int nodes = 0;                     // NUMA nodes the threads were pinned to, 0 when not pinned
+	int ranks = 1;
+	int repetitions = 0;
+	double minMicroseconds = 0;
+	double medianMicroseconds = 0;
+	double p99Microseconds = 0;
+	double megapixelsPerSecond = 0;
+	double efficiency = 0;             // Sequential median / (median * threads * ranks)
+	double imbalance = 0;              // Longest / mean filter time of the ranks in the last run, 0 when not measured
+};
+
+// Parse --backend, --kernel, --passes, --threads, --nodes, --ranks, --size, --type, --input, --warmup, --reps, --format, --output,
+// --trace, --counters, --verify, --baseline and --tolerance.
+// Lists are comma separated, sizes are WIDTHxHEIGHT and types are like 8UC1, 16UC3 or 32FC4. Returns false with
+// a message on a bad argument.
+bool parseBenchmarkOptions(int argc, char** argv, BenchmarkOptions& options, cv::String& error);
+void printBenchmarkUsage(const char* program);
+
+// The name of a pixel type as --type takes it, like 8UC1
+const char* benchmarkTypeName(const int type);
+
+// A communicator of the first ranks processes counted from the collector, so the collector is always rank 0 in it.
+// MPI_COMM_NULL on the other processes.
+MPI_Comm splitRanks(const int ranks, const int world_size, const int world_rank, const int collector);
+
+// Run every combination. All processes of MPI_COMM_WORLD must call it, the results are only complete on the collector.
+std::vector<BenchmarkResult> runBenchmark(const BenchmarkOptions& options, const int world_size, const int world_rank, const int collector);
+
+void writeBenchmarkResults(std::ostream& output, const std::vector<BenchmarkResult>& results, const cv::String& format);
+
+// Compare the throughput of every result with the same configuration (backend, size, type, kernel, passes, threads,
+// nodes and ranks) in a CSV written by an earlier run with --format csv. Prints the configurations that lost more than
+// tolerance percent of their baseline megapixels per second and returns how many did, or -1 when the baseline
+// cannot be read.
+int compareWithBaseline(const std::vector<BenchmarkResult>& results, const cv::String& baselinePath, const double tolerance);
+
+// Headless entry point used by main when it gets command line arguments, returns the exit code
+int benchmarkMain(int argc, char** argv, const int world_size, const int world_rank, const int collector);
@@ -0,0 +1,279 @@
+#include "LPF_BoxFilter.h"
+
+using namespace cv;
+using namespace std;
+
+// Running sums of each pixel type. 8-bit sums fit in 32 bits for kernels below 2048, 16-bit ones need 64 bits
+// and float ones are kept in double so the rounding of adding and removing rows stays far below float precision.
+// Integer averages are rounded to the nearest value, the same way on every backend and instruction set.
+template <typename T> struct BoxPixel;
+
+template <> struct BoxPixel<uchar>
+{
+    typedef unsigned int Sum;
+    typedef BoxDivisor Divisor;
+    static Divisor divisor(const int kernelSize) { return boxDivisor(kernelSize); }
+    static uchar average(const Sum sum, const Divisor& divisor) { return boxDivide(sum, divisor); }
+};
+
+template <> struct BoxPixel<ushort>
+{
+    typedef unsigned long long Sum;
+    struct Divisor { Sum half; double scale; };
+    static Divisor divisor(const int kernelSize) {
+        const Sum area = (Sum)kernelSize * kernelSize;
+        Divisor divisor = { area / 2, 1.0 / area };
+        return divisor;
+    }
+    // Sums stay below 2^38, well inside the 53 bits of a double, and (n + 0.5) / area is never closer than
+    // 0.5 / area to an integer, so truncating it in double gives exactly (sum + area / 2) / area
+    static ushort average(const Sum sum, const Divisor& divisor) { return (ushort)(unsigned int)((sum + divisor.half + 0.5) * divisor.scale); }
+};
+
+template <> struct BoxPixel<float>
+{
+    typedef double Sum;
+    typedef double Divisor;
+    static Divisor divisor(const int kernelSize) { return 1.0 / ((double)kernelSize * kernelSize); }
+    static float average(const Sum sum, const Divisor& scale) { return (float)(sum * scale); }
+};
+
+// Scalar row operations for CN interleaved channels. The column sums hold one sum per channel of every column,
+// so adding a row is the same loop whatever the channel count, and only the horizontal window steps by CN.
+template <typename T, int CN>
+struct ScalarBoxRows
+{
+    typedef typename BoxPixel<T>::Sum Sum;
+
+    static void addRow(Sum* columnSums, const T* row, const int count) {
+        for (int i = 0; i < count; i++) {
+            columnSums[i] += row[i];
+        }
+    }
+
+    static void subtractRow(Sum* columnSums, const T* row, const int count) {
+        for (int i = 0; i < count; i++) {
+            columnSums[i] -= row[i];
+        }
+    }
+
+    static void slideRow(Sum* columnSums, const T* addedRow, const T* removedRow, const int count) {
+        for (int i = 0; i < count; i++) {
+            columnSums[i] += (Sum)addedRow[i] - (Sum)removedRow[i];
+        }
+    }
+
+    // prefixSums[c] = 0 and prefixSums[i + CN] = prefixSums[i] + columnSums[i], a prefix sum per channel
+    static void prefixSum(Sum* prefixSums, const Sum* columnSums, const int count) {
+        for (int c = 0; c < CN; c++) {
+            prefixSums[c] = 0;
+        }
+        for (int i = 0; i < count; i++) {
+            prefixSums[i + CN] = prefixSums[i] + columnSums[i];
+        }
+    }
+
+    static void averageRow(T* outputRow, const Sum* prefixSums, const int width, const int kernelSize) {
+        const typename BoxPixel<T>::Divisor divisor = BoxPixel<T>::divisor(kernelSize);
+        const int window = kernelSize * CN;
+        for (int i = 0; i < width * CN; i++) {
+            outputRow[i] = BoxPixel<T>::average(prefixSums[i + window] - prefixSums[i], divisor);
+        }
+    }
+};
+
+// Row operations used by the engine, chosen at compile time from the pixel type and the channel count.
+// Only 8-bit pixels have vector kernels: the vertical ones do not care about channels, and single channel
+// images use the vector prefix sums and averages as well.
+template <typename T, int CN>
+struct BoxRows : ScalarBoxRows<T, CN>
+{
+    explicit BoxRows(const BoxRowKernels&) {}
+};
+
+template <int CN>
+struct BoxRows<uchar, CN> : ScalarBoxRows<uchar, CN>
+{
+    const BoxRowKernels& kernels;
+    explicit BoxRows(const BoxRowKernels& rowKernels) : kernels(rowKernels) {}
+
+    void addRow(unsigned int* columnSums, const uchar* row, const int count) const { kernels.addRow(columnSums, row, count); }
+    void subtractRow(unsigned int* columnSums, const uchar* row, const int count) const { kernels.subtractRow(columnSums, row, count); }
+    void slideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) const { kernels.slideRow(columnSums, addedRow, removedRow, count); }
+};
+
+template <>
+struct BoxRows<uchar, 1>
+{
+    const BoxRowKernels& kernels;
+    explicit BoxRows(const BoxRowKernels& rowKernels) : kernels(rowKernels) {}
+
+    void addRow(unsigned int* columnSums, const uchar* row, const int count) const { kernels.addRow(columnSums, row, count); }
+    void subtractRow(unsigned int* columnSums, const uchar* row, const int count) const { kernels.subtractRow(columnSums, row, count); }
+    void slideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) const { kernels.slideRow(columnSums, addedRow, removedRow, count); }
+    void prefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) const { kernels.prefixSum(prefixSums, columnSums, count); }
+    void averageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) const { kernels.averageRow(outputRow, prefixSums, width, kernelSize); }
+};
+
+template <typename T, int CN>
+static void boxFilterRegion(const Mat& inputImage, Mat& outputImage, const int kernelSize, const Rect& region, const int borderType, FilterScratch& scratch) {
+    typedef typename BoxPixel<T>::Sum Sum;
+    const BoxRows<T, CN> rows(getBoxRowKernels());
+    const int paddingSize = kernelSize / 2;
+
+    // Column sums cover the region plus the padding on both sides. The columns inside the input are updated
+    // by the row kernels without any test for the border.
+    const int firstColumn = region.x - paddingSize;
+    const int endColumn = region.x + region.width + paddingSize;
+    const int imageBegin = max(firstColumn, 0);
+    const int imageEnd = min(endColumn, inputImage.cols);
+    const int columnCount = (region.width + 2 * paddingSize) * CN;
+    Sum* columnSums = scratch.buffer<Sum>(0, columnCount);
+    Sum* prefixSums = scratch.buffer<Sum>(1, columnCount + CN);
+    fill(columnSums, columnSums + columnCount, (Sum)0);
+    Sum* imageSums = columnSums + (imageBegin - firstColumn) * CN;
+    const int imageCount = max(imageEnd - imageBegin, 0) * CN;
+
+    // The at most kernelSize - 1 columns outside the input sum the column the border maps them to. With a constant
+    // border they map to none and stay zero, which gives the zero padding for free.
+    int* borderSums = scratch.buffer<int>(2, region.width + 2 * paddingSize);
+    int* borderSources = scratch.buffer<int>(3, region.width + 2 * paddingSize);
+    int borderCount = 0;
+    for (int x = firstColumn; x < endColumn; x++) {
+        const int source = x < imageBegin || x >= imageEnd ? borderInterpolate(x, inputImage.cols, borderType) : -1;
+        if (source >= 0) {
+            borderSums[borderCount] = (x - firstColumn) * CN;
+            borderSources[borderCount] = source * CN;
+            borderCount++;
+        }
+    }
+    auto updateBorderSums = [&](const T* addedRow, const T* removedRow) {
+        for (int b = 0; b < borderCount; b++) {
+            for (int c = 0; c < CN; c++) {
+                if (addedRow != nullptr) {
+                    columnSums[borderSums[b] + c] += addedRow[borderSources[b] + c];
+                }
+                if (removedRow != nullptr) {
+                    columnSums[borderSums[b] + c] -= removedRow[borderSources[b] + c];
+                }
+            }
+        }
+    };
+
+    // Rows outside the input are read from the row the border maps them to, or skipped with a constant border
+    auto sourceRow = [&](const int y) {
+        const int source = borderInterpolate(y, inputImage.rows, borderType);
+        return source >= 0 ? inputImage.ptr<T>(source) : (const T*)nullptr;
+    };
+
+    // Prime the column sums with the rows around the first output row
+    for (int y = region.y - paddingSize; y <= region.y + paddingSize; y++) {
+        const T* row = sourceRow(y);
+        if (row != nullptr) {
+            rows.addRow(imageSums, row + imageBegin * CN, imageCount);
+            updateBorderSums(row, nullptr);
+        }
+    }
+
+    for (int i = 0; i < region.height; i++) {
+        const int y = region.y + i;
+
+        // Every horizontal window of kernelSize column sums is the difference of two prefix sums
+        rows.prefixSum(prefixSums, columnSums, columnCount);
+        rows.averageRow(outputImage.ptr<T>(i), prefixSums, region.width, kernelSize);
+
+        // Move the vertical window one row down
+        if (i + 1 < region.height) {
+            const T* addedRow = sourceRow(y + paddingSize + 1);
+            const T* removedRow = sourceRow(y - paddingSize);
+            if (addedRow != nullptr && removedRow != nullptr) {
+                rows.slideRow(imageSums, addedRow + imageBegin * CN, removedRow + imageBegin * CN, imageCount);
+            }
+            else if (addedRow != nullptr) {
+                rows.addRow(imageSums, addedRow + imageBegin * CN, imageCount);
+            }
+            else if (removedRow != nullptr) {
+                rows.subtractRow(imageSums, removedRow + imageBegin * CN, imageCount);
+            }
+            updateBorderSums(addedRow, removedRow);
+        }
+    }
+}
+
+template <typename T>
+static void boxFilterChannels(const Mat& inputImage, Mat& outputImage, const int kernelSize, const Rect& region, const int borderType, FilterScratch& scratch) {
+    switch (inputImage.channels()) {
+    case 1:
+        boxFilterRegion<T, 1>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    case 3:
+        boxFilterRegion<T, 3>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    case 4:
+        boxFilterRegion<T, 4>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    }
+}
+
+Mat FilterScratch::image(const int index, const Size& size, const int type) {
+    Mat& buffer = images[index];
+    if (buffer.type() != type || buffer.rows < size.height || buffer.cols < size.width) {
+        buffer.create(max(buffer.rows, size.height), max(buffer.cols, size.width), type);
+    }
+    return buffer(Rect(Point(0, 0), size));
+}
+
+void FilterScratch::release() {
+    for (vector<double>& slot : slots) {
+        vector<double>().swap(slot);
+    }
+    for (Mat& image : images) {
+        image.release();
+    }
+}
+
+FilterScratch& threadScratch() {
+    static thread_local FilterScratch scratch;
+    return scratch;
+}
+
+bool isBoxFilterType(const int type) {
+    const int depth = CV_MAT_DEPTH(type);
+    const int channels = CV_MAT_CN(type);
+    return (depth == CV_8U || depth == CV_16U || depth == CV_32F) && (channels == 1 || channels == 3 || channels == 4);
+}
+
+bool isBorderType(const int borderType) {
+    return borderType == BORDER_CONSTANT || borderType == BORDER_REPLICATE || borderType == BORDER_REFLECT || borderType == BORDER_WRAP || borderType == BORDER_REFLECT_101;
+}
+
+void boxLowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize, const Rect& region, const int borderType, FilterScratch& scratch) {
+    CV_Assert(isBoxFilterType(inputImage.type()) && outputImage.type() == inputImage.type());
+    CV_Assert(isBorderType(borderType));
+    CV_Assert(kernelSize > 0 && kernelSize % 2 == 1 && kernelSize < 2048); // 255 * k * k must fit in a signed 32-bit lane
+    CV_Assert(outputImage.size() == region.size());
+    if (region.empty()) {
+        return;
+    }
+
+    switch (inputImage.depth()) {
+    case CV_8U:
+        boxFilterChannels<uchar>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    case CV_16U:
+        boxFilterChannels<ushort>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    case CV_32F:
+        boxFilterChannels<float>(inputImage, outputImage, kernelSize, region, borderType, scratch);
+        break;
+    }
+}
+
+Mat boxLowPassFilter(const Mat& inputImage, const int kernelSize, const int borderType) {
+    // Create an output image with the same size as the input image
+    Mat outputImage(inputImage.size(), inputImage.type());
+
+    boxLowPassFilter(inputImage, outputImage, kernelSize, Rect(0, 0, inputImage.cols, inputImage.rows), borderType);
+
+    return outputImage;
+}
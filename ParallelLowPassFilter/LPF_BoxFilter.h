@@ -0,0 +1,61 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utils/logger.hpp>
+
+#include "LPF_SIMD.h"
+
+// Box filter engine shared by all backends. The cost per output pixel does not depend on the kernel size:
+// every column keeps a running vertical sum that is updated with one added and one removed row, and each
+// output row is produced from prefix sums over those column sums. The row kernels come from LPF_SIMD and are
+// picked at runtime for the instruction sets of the CPU.
+//
+// The output pixel (y, x) is the average of the kernelSize x kernelSize neighbourhood of the input pixel
+// (region.y + y, region.x + x). Pixels outside the input image are taken from the pixel borderInterpolate maps
+// them to, or count as zero with BORDER_CONSTANT. The result is the same as padding the image with
+// copyMakeBorder and averaging, but rows outside the image are read from the rows they map to and the few
+// columns outside it get their own column sums, so no padded copy is made.
+//
+// Pixels may be 8-bit, 16-bit or float with 1, 3 or 4 interleaved channels, each channel is filtered on its
+// own without splitting the image. Integer averages are rounded to the nearest value, float ones are computed in double.
+bool isBoxFilterType(const int type);
+
+// BORDER_CONSTANT (zero), BORDER_REPLICATE, BORDER_REFLECT, BORDER_WRAP and BORDER_REFLECT_101
+bool isBorderType(const int borderType);
+
+// Working memory of the filters that only grows, so filtering regions of the same size again allocates nothing.
+// One thread uses a scratch at a time. The filters use the one of the calling thread unless they are given
+// another, such as the ones a LowPassFilterContext keeps.
+class FilterScratch
+{
+public:
+	// Room for count values of T in one of a few slots, which keep their memory between calls but not their values
+	template <typename T>
+	T* buffer(const int slot, const size_t count) {
+		std::vector<double>& memory = slots[slot];
+		const size_t words = (count * sizeof(T) + sizeof(double) - 1) / sizeof(double);
+		if (memory.size() < words) {
+			memory.resize(words);
+		}
+		return (T*)memory.data();
+	}
+
+	// The top left size of one of two image buffers of the type, for the images between passes
+	cv::Mat image(const int index, const cv::Size& size, const int type);
+
+	// Free all memory
+	void release();
+
+private:
+	std::vector<double> slots[4];
+	cv::Mat images[2];
+};
+
+// The scratch of the calling thread
+FilterScratch& threadScratch();
+
+void boxLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize, const cv::Rect& region, const int borderType = cv::BORDER_CONSTANT, FilterScratch& scratch = threadScratch());
+cv::Mat boxLowPassFilter(const cv::Mat& inputImage, const int kernelSize, const int borderType = cv::BORDER_CONSTANT);
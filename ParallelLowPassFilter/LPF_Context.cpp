@@ -0,0 +1,60 @@
+#include "LPF_Context.h"
+
+using namespace cv;
+using namespace std;
+
+LowPassFilterContext::LowPassFilterContext(const FilterKernel& kernel, const int num_of_threads, const int border, const int passes)
+    : filterKernel(kernel), threadCount(num_of_threads), borderType(border), passCount(passes) {
+    CV_Assert(num_of_threads > 0 && passes > 0 && isBorderType(border));
+}
+
+LowPassFilterContext::LowPassFilterContext(const int kernelSize, const int num_of_threads)
+    : LowPassFilterContext(FilterKernel::box(kernelSize), num_of_threads) {
+}
+
+unique_ptr<LowPassFilterContext::ScratchSet> LowPassFilterContext::borrowScratch() {
+    lock_guard<mutex> lock(scratchMutex);
+    if (freeScratch.empty()) {
+        return unique_ptr<ScratchSet>(new ScratchSet(threadCount));
+    }
+    unique_ptr<ScratchSet> scratch = move(freeScratch.back());
+    freeScratch.pop_back();
+    return scratch;
+}
+
+void LowPassFilterContext::returnScratch(unique_ptr<ScratchSet> scratch) {
+    lock_guard<mutex> lock(scratchMutex);
+    freeScratch.push_back(move(scratch));
+}
+
+void LowPassFilterContext::filter(const Mat& inputImage, Mat& outputImage, const Rect& region) {
+    CV_Assert(isBoxFilterType(inputImage.type()) && outputImage.type() == inputImage.type());
+    CV_Assert(outputImage.size() == region.size() && (region & Rect(0, 0, inputImage.cols, inputImage.rows)) == region);
+    CV_Assert(inputImage.data != outputImage.data);
+
+    // The scratch goes back to the context even when the filter throws
+    struct Borrowed
+    {
+        LowPassFilterContext& context;
+        unique_ptr<ScratchSet> scratch;
+        ~Borrowed() { context.returnScratch(move(scratch)); }
+    } borrowed = { *this, borrowScratch() };
+
+    openMPMultiPassLowPassFilter(inputImage, Point(0, 0), inputImage.size(), outputImage, filterKernel, passCount, region, threadCount, borderType, borrowed.scratch->data());
+}
+
+void LowPassFilterContext::filter(const Mat& inputImage, Mat& outputImage) {
+    filter(inputImage, outputImage, Rect(0, 0, inputImage.cols, inputImage.rows));
+}
+
+void LowPassFilterContext::filter(const void* input, const size_t inputStep, void* output, const size_t outputStep, const Size& size, const int type) {
+    // Headers on the caller's memory, nothing is copied
+    const Mat inputImage(size, type, const_cast<void*>(input), inputStep);
+    Mat outputImage(size, type, output, outputStep);
+    filter(inputImage, outputImage);
+}
+
+void LowPassFilterContext::releaseScratch() {
+    lock_guard<mutex> lock(scratchMutex);
+    freeScratch.clear();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "LPF_OpenMP.h"
+
+// A filter to embed in another program, on images the caller owns. It keeps the kernel, the border, the number of
+// passes and of threads, and the working memory of its threads, so filtering images of the same size again
+// allocates nothing. Several threads may filter with the same context at once: every call borrows a set of
+// working memory of its own, and a new set is only made when calls overlap. No window, file or MPI is involved.
+class LowPassFilterContext
+{
+public:
+	explicit LowPassFilterContext(const FilterKernel& kernel, const int num_of_threads = 1, const int borderType = cv::BORDER_CONSTANT, const int passes = 1);
+	LowPassFilterContext(const int kernelSize, const int num_of_threads = 1);
+
+	// Filter inputImage into outputImage, which has the same size and type and does not share its pixels
+	void filter(const cv::Mat& inputImage, cv::Mat& outputImage);
+
+	// Filter the region of inputImage into outputImage of the region's size
+	void filter(const cv::Mat& inputImage, cv::Mat& outputImage, const cv::Rect& region);
+
+	// Filter an image in the caller's memory, given as rows of size.width pixels of type that start step bytes apart
+	void filter(const void* input, const size_t inputStep, void* output, const size_t outputStep, const cv::Size& size, const int type);
+
+	// Free the working memory no call is using, for example after a few unusually large images
+	void releaseScratch();
+
+	const FilterKernel& kernel() const { return filterKernel; }
+	int threads() const { return threadCount; }
+	int border() const { return borderType; }
+	int passes() const { return passCount; }
+
+private:
+	typedef std::vector<FilterScratch> ScratchSet; // One scratch per thread
+
+	std::unique_ptr<ScratchSet> borrowScratch();
+	void returnScratch(std::unique_ptr<ScratchSet> scratch);
+
+	FilterKernel filterKernel;
+	int threadCount;
+	int borderType;
+	int passCount;
+	std::mutex scratchMutex;
+	std::vector<std::unique_ptr<ScratchSet>> freeScratch;
+};
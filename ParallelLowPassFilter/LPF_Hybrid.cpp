@@ -0,0 +1,268 @@
+#include "LPF_Hybrid.h"
+
+using namespace cv;
+using namespace std;
+
+void hybridGridSize(const Size& imageSize, const int kernelSize, const int world_size, int& gridRows, int& gridCols) {
+    // Every block must be at least paddingSize pixels on each side to fill the halo of its neighbours
+    const int minimumSide = max(kernelSize / 2, 1);
+    const int maxGridRows = max(1, min(world_size, imageSize.height / minimumSide));
+    const int maxGridCols = max(1, imageSize.width / minimumSide);
+
+    gridRows = 1;
+    gridCols = 1;
+    long long bestHalo = -1;
+    for (int rows = 1; rows <= maxGridRows; rows++) {
+        int cols = min(world_size / rows, maxGridCols);
+
+        // The halo of all blocks together grows with the length of the cuts through the image, so a tall,
+        // narrow image gets more rows of blocks than columns
+        long long halo = (long long)(rows - 1) * imageSize.width + (long long)(cols - 1) * imageSize.height;
+        if (rows * cols > gridRows * gridCols || (rows * cols == gridRows * gridCols && halo < bestHalo)) {
+            gridRows = rows;
+            gridCols = cols;
+            bestHalo = halo;
+        }
+    }
+}
+
+// Split length into blocks that differ by at most one, the first ones get the leftover
+static void blockRange(const int length, const int blocks, const int index, int& first, int& size) {
+    size = length / blocks;
+    int leftOver = length % blocks;
+    first = index * size + min(index, leftOver);
+    if (index < leftOver) {
+        size += 1;
+    }
+}
+
+// A datatype for a rectangle of a continuous image, so blocks and edges are sent without packing them first.
+// A pixel is elemSize() bytes, which covers every pixel type and channel count.
+static MPI_Datatype rectType(const Mat& image, const Rect& rect) {
+    int sizes[2] = { image.rows, image.cols };
+    int subsizes[2] = { rect.height, rect.width };
+    int starts[2] = { rect.y, rect.x };
+
+    MPI_Datatype pixelType, type;
+    MPI_Type_contiguous((int)image.elemSize(), MPI_BYTE, &pixelType);
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, pixelType, &type);
+    MPI_Type_commit(&type);
+    MPI_Type_free(&pixelType);
+    return type;
+}
+
+// Rows or columns [first, first + size) of a block that has paddingSize pixels of halo on both sides. Side -1 is
+// the edge next to the previous block, 0 the whole block and 1 the edge next to the next block.
+static void edgeRange(const int side, const int length, const int paddingSize, const bool halo, int& first, int& size) {
+    if (side == 0) {
+        first = paddingSize;
+        size = length;
+    }
+    else {
+        first = side < 0 ? (halo ? 0 : paddingSize) : (halo ? paddingSize + length : length);
+        size = paddingSize;
+    }
+}
+
+void hybridMultiPassLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm, const int borderType) {
+    CV_Assert(passes > 0);
+
+    // The edges of each block come from the neighbouring processes, or from the border at the image edges. One
+    // halo serves all passes, so it is kernel.size() / 2 pixels deep per pass.
+    int paddingSize = passes * (kernel.size() / 2);
+
+    // Arrange the processes in a grid, the ones that do not fit get MPI_COMM_NULL and sit this image out. With a
+    // wrapped border the grid is periodic, so the blocks at opposite edges exchange their edges like neighbours.
+    // A single block along a dimension wraps onto itself, which fillWindowBorder does without any message.
+    int dims[2], periods[2];
+    hybridGridSize(inputImage.size(), 2 * paddingSize + 1, world_size, dims[0], dims[1]);
+    periods[0] = borderType == BORDER_WRAP && dims[0] > 1;
+    periods[1] = borderType == BORDER_WRAP && dims[1] > 1;
+    MPI_Comm gridComm;
+    MPI_Cart_create(comm, 2, dims, periods, 0, &gridComm);
+
+    // Without reordering, the process at (row, col) of the grid is rank row * dims[1] + col in comm too
+    const int activeSize = dims[0] * dims[1];
+    Rect localBlock;
+    int coords[2] = { 0, 0 };
+    if (gridComm != MPI_COMM_NULL) {
+        MPI_Cart_coords(gridComm, world_rank, 2, coords);
+        blockRange(inputImage.rows, dims[0], coords[0], localBlock.y, localBlock.height);
+        blockRange(inputImage.cols, dims[1], coords[1], localBlock.x, localBlock.width);
+    }
+    int localHeight = localBlock.height;
+    int localWidth = localBlock.width;
+
+    // Allocate memory for the local block with room for the halo on all four sides, and the output block
+    Mat localWindow = Mat::zeros(localHeight + 2 * paddingSize, localWidth + 2 * paddingSize, inputImage.type());
+    Mat localOutputImage(localHeight, localWidth, inputImage.type());
+
+    // Scatter the blocks of the input image, straight from the caller's buffer when it is continuous
+    vector<MPI_Request> requests;
+    vector<MPI_Datatype> types;
+    Mat sendImage;
+    TraceScope scatterScope("scatter");
+    if (world_rank == collector) {
+        sendImage = inputImage.isContinuous() ? inputImage : inputImage.clone();
+        for (int rank = 0; rank < activeSize; rank++) {
+            Rect block;
+            blockRange(inputImage.rows, dims[0], rank / dims[1], block.y, block.height);
+            blockRange(inputImage.cols, dims[1], rank % dims[1], block.x, block.width);
+            types.push_back(rectType(sendImage, block));
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(sendImage.data, 1, types.back(), rank, 0, comm, &requests.back());
+        }
+    }
+    if (gridComm != MPI_COMM_NULL) {
+        types.push_back(rectType(localWindow, Rect(paddingSize, paddingSize, localWidth, localHeight)));
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Irecv(localWindow.data, 1, types.back(), collector, 0, comm, &requests.back());
+    }
+    MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    for (MPI_Datatype& type : types) {
+        MPI_Type_free(&type);
+    }
+    requests.clear();
+    types.clear();
+    scatterScope.end();
+
+    if (gridComm != MPI_COMM_NULL) {
+        // Post the exchange of the edges and corners with the eight neighbours without waiting for it. The message
+        // sent towards (dr, dc) is tagged with that direction, so the neighbour receives it from (-dr, -dc).
+        if (paddingSize > 0) {
+            for (int dr = -1; dr <= 1; dr++) {
+                for (int dc = -1; dc <= 1; dc++) {
+                    int neighbourCoords[2] = { coords[0] + dr, coords[1] + dc };
+                    const bool rowOutside = neighbourCoords[0] < 0 || neighbourCoords[0] >= dims[0];
+                    const bool colOutside = neighbourCoords[1] < 0 || neighbourCoords[1] >= dims[1];
+                    if ((dr == 0 && dc == 0) || (rowOutside && !periods[0]) || (colOutside && !periods[1])) {
+                        continue;
+                    }
+                    int neighbour;
+                    MPI_Cart_rank(gridComm, neighbourCoords, &neighbour);
+
+                    Rect sendRect, receiveRect;
+                    edgeRange(dr, localHeight, paddingSize, false, sendRect.y, sendRect.height);
+                    edgeRange(dc, localWidth, paddingSize, false, sendRect.x, sendRect.width);
+                    edgeRange(dr, localHeight, paddingSize, true, receiveRect.y, receiveRect.height);
+                    edgeRange(dc, localWidth, paddingSize, true, receiveRect.x, receiveRect.width);
+
+                    types.push_back(rectType(localWindow, receiveRect));
+                    requests.push_back(MPI_REQUEST_NULL);
+                    MPI_Irecv(localWindow.data, 1, types.back(), neighbour, 1 + (1 - dr) * 3 + (1 - dc), gridComm, &requests.back());
+                    types.push_back(rectType(localWindow, sendRect));
+                    requests.push_back(MPI_REQUEST_NULL);
+                    MPI_Isend(localWindow.data, 1, types.back(), neighbour, 1 + (1 + dr) * 3 + (1 + dc), gridComm, &requests.back());
+                }
+            }
+        }
+
+        // While the edges are in flight, filter the interior pixels whose passes stay inside the block with the
+        // OpenMP tiles. The window is in image coordinates from the top left of its halo.
+        const Point windowOrigin = localBlock.tl() - Point(paddingSize, paddingSize);
+        Rect interior;
+        interior.y = min(paddingSize, localHeight);
+        interior.x = min(paddingSize, localWidth);
+        interior.height = max(localHeight - 2 * paddingSize, 0);
+        interior.width = max(localWidth - 2 * paddingSize, 0);
+        Mat interiorOutput = localOutputImage(interior);
+        TraceScope interiorScope("compute");
+        openMPMultiPassLowPassFilter(localWindow, windowOrigin, inputImage.size(), interiorOutput, kernel, passes, interior + localBlock.tl(), num_of_threads, borderType);
+        interiorScope.end();
+
+        // Wait for the exchange, then filter the frame around the interior. Blocks at the image edges receive
+        // nothing on that side, they fill that part of the halo from their own pixels for the border, or leave
+        // it zero for a constant border.
+        TraceScope haloScope("halo exchange");
+        MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        for (MPI_Datatype& type : types) {
+            MPI_Type_free(&type);
+        }
+        requests.clear();
+        types.clear();
+        haloScope.end();
+        TraceScope padScope("pad");
+        fillWindowBorder(localWindow, windowOrigin, inputImage.size(), borderType);
+        padScope.end();
+
+        Rect frame[4] = {
+            Rect(0, 0, localWidth, interior.y),
+            Rect(0, interior.y + interior.height, localWidth, localHeight - interior.y - interior.height),
+            Rect(0, interior.y, interior.x, interior.height),
+            Rect(interior.x + interior.width, interior.y, localWidth - interior.x - interior.width, interior.height)
+        };
+        TraceScope frameScope("compute");
+        for (const Rect& part : frame) {
+            Mat partOutput = localOutputImage(part);
+            openMPMultiPassLowPassFilter(localWindow, windowOrigin, inputImage.size(), partOutput, kernel, passes, part + localBlock.tl(), num_of_threads, borderType);
+        }
+    }
+
+    // Gather the filtered blocks into the root's output image, through a temporary one if it is not continuous
+    TraceScope gatherScope("gather");
+    Mat receiveImage;
+    if (world_rank == collector) {
+        CV_Assert(outputImage.size() == inputImage.size() && outputImage.type() == inputImage.type());
+        receiveImage = outputImage.isContinuous() ? outputImage : Mat(outputImage.size(), outputImage.type());
+        for (int rank = 0; rank < activeSize; rank++) {
+            Rect block;
+            blockRange(inputImage.rows, dims[0], rank / dims[1], block.y, block.height);
+            blockRange(inputImage.cols, dims[1], rank % dims[1], block.x, block.width);
+            types.push_back(rectType(receiveImage, block));
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(receiveImage.data, 1, types.back(), rank, 2, comm, &requests.back());
+        }
+    }
+    if (gridComm != MPI_COMM_NULL) {
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(localOutputImage.data, localHeight * localWidth * (int)localOutputImage.elemSize(), MPI_BYTE, collector, 2, comm, &requests.back());
+    }
+    MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    for (MPI_Datatype& type : types) {
+        MPI_Type_free(&type);
+    }
+    if (world_rank == collector && receiveImage.data != outputImage.data) {
+        receiveImage.copyTo(outputImage);
+    }
+    gatherScope.end();
+
+    if (gridComm != MPI_COMM_NULL) {
+        MPI_Comm_free(&gridComm);
+    }
+}
+
+void hybridLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm, const int borderType) {
+    hybridMultiPassLowPassFilter(inputImage, outputImage, kernel, 1, world_size, world_rank, collector, num_of_threads, comm, borderType);
+}
+
+void hybridLowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm) {
+    hybridLowPassFilter(inputImage, outputImage, FilterKernel::box(kernelSize), world_size, world_rank, collector, num_of_threads, comm);
+}
+
+Mat hybridLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm, const int borderType) {
+    // Initialize the output image on the root process
+    Mat outputImage;
+    if (world_rank == collector) {
+        outputImage = Mat(inputImage.size(), inputImage.type());
+    }
+
+    hybridLowPassFilter(inputImage, outputImage, kernel, world_size, world_rank, collector, num_of_threads, comm, borderType);
+
+    return outputImage;
+}
+
+Mat hybridLowPassFilter(const Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm) {
+    return hybridLowPassFilter(inputImage, FilterKernel::box(kernelSize), world_size, world_rank, collector, num_of_threads, comm);
+}
+
+Mat hybridMultiPassLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm, const int borderType) {
+    // Initialize the output image on the root process
+    Mat outputImage;
+    if (world_rank == collector) {
+        outputImage = Mat(inputImage.size(), inputImage.type());
+    }
+
+    hybridMultiPassLowPassFilter(inputImage, outputImage, kernel, passes, world_size, world_rank, collector, num_of_threads, comm, borderType);
+
+    return outputImage;
+}
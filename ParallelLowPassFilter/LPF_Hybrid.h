@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utils/logger.hpp>
+#include <mpi.h>
+
+#include "LPF_OpenMP.h"
+
+// Pick a grid of gridRows x gridCols blocks for the image. It uses as many processes as possible while keeping
+// every block at least kernelSize / 2 pixels high and wide, then the grid with the smallest halo.
+void hybridGridSize(const cv::Size& imageSize, const int kernelSize, const int world_size, int& gridRows, int& gridCols);
+
+// Filter with one process per node and OpenMP tiles inside every process. The image is split into a 2D grid of
+// blocks on a Cartesian communicator, and every block exchanges its edges and corners with its eight neighbours.
+// Like MPILowPassFilter, every process of comm needs the size of the input but only the collector reads its pixels.
+void hybridLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+void hybridLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD);
+cv::Mat hybridLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat hybridLowPassFilter(const cv::Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD);
+
+// Filter with passes passes of the kernel. Every block exchanges one halo of passes * kernel.size() / 2 pixels,
+// so blocks are at least that big, and its OpenMP tiles go through all passes while they are in cache.
+void hybridMultiPassLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat hybridMultiPassLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const int num_of_threads, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
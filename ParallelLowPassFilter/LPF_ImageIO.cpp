@@ -0,0 +1,288 @@
+#include "LPF_ImageIO.h"
+#include <cctype>
+#include <sstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// Read the next token of a PNM header, skipping white space and comments
+static bool readHeaderToken(istream& file, string& token) {
+    int c = file.get();
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = file.get();
+            }
+        }
+        else if (!isspace(c)) {
+            break;
+        }
+        c = file.get();
+    }
+
+    token.clear();
+    while (c != EOF && !isspace(c)) {
+        token += (char)c;
+        c = file.get();
+    }
+    // Exactly one white space character separates the header from the pixels
+    return !token.empty() && c != EOF;
+}
+
+static bool readHeaderNumber(istream& file, int& value) {
+    string token;
+    if (!readHeaderToken(file, token) || token.find_first_not_of("0123456789") != string::npos) {
+        return false;
+    }
+    value = atoi(token.c_str());
+    return true;
+}
+
+bool readImageHeader(istream& file, ImageFileHeader& header) {
+    string magic;
+    if (!readHeaderToken(file, magic)) {
+        return false;
+    }
+    if (magic == "P5") {
+        int maxValue;
+        if (!readHeaderNumber(file, header.cols) || !readHeaderNumber(file, header.rows) || !readHeaderNumber(file, maxValue)) {
+            return false;
+        }
+        if (maxValue <= 0 || maxValue > 255) {
+            return false;
+        }
+        header.format = FORMAT_PGM;
+        header.type = CV_8UC1;
+    }
+    else if (magic == "Pf" || magic == "PF") {
+        string scale;
+        if (!readHeaderNumber(file, header.cols) || !readHeaderNumber(file, header.rows) || !readHeaderToken(file, scale)) {
+            return false;
+        }
+        // A positive scale means big-endian floats, which cannot be used in place
+        if (atof(scale.c_str()) >= 0) {
+            return false;
+        }
+        header.format = FORMAT_PFM;
+        header.type = magic == "Pf" ? CV_32FC1 : CV_32FC3;
+    }
+    else {
+        return false;
+    }
+    if (header.cols <= 0 || header.rows <= 0) {
+        return false;
+    }
+    header.dataOffset = file.tellg();
+    return true;
+}
+
+bool writeImageHeader(ostream& file, ImageFileHeader& header) {
+    switch (header.format) {
+    case FORMAT_PGM:
+        CV_Assert(header.type == CV_8UC1);
+        file << "P5\n" << header.cols << " " << header.rows << "\n255\n";
+        break;
+    case FORMAT_PFM:
+        CV_Assert(header.type == CV_32FC1 || header.type == CV_32FC3);
+        file << (header.type == CV_32FC1 ? "Pf\n" : "PF\n") << header.cols << " " << header.rows << "\n-1.0\n";
+        break;
+    default:
+        break;
+    }
+    header.dataOffset = file.tellp();
+    return (bool)file;
+}
+
+bool readImageRows(istream& file, const ImageFileHeader& header, const int firstRow, Mat& rows) {
+    CV_Assert(rows.type() == header.type && rows.cols == header.cols && rows.isContinuous());
+    CV_Assert(firstRow >= 0 && firstRow + rows.rows <= header.rows);
+
+    const streamoff rowBytes = (streamoff)rows.cols * rows.elemSize();
+    file.seekg(header.dataOffset + firstRow * rowBytes);
+    return (bool)file.read((char*)rows.data, rows.rows * rowBytes);
+}
+
+bool writeImageRows(ostream& file, const ImageFileHeader& header, const int firstRow, const Mat& rows) {
+    CV_Assert(rows.type() == header.type && rows.cols == header.cols && rows.isContinuous());
+    CV_Assert(firstRow >= 0 && firstRow + rows.rows <= header.rows);
+
+    const streamoff rowBytes = (streamoff)rows.cols * rows.elemSize();
+    file.seekp(header.dataOffset + firstRow * rowBytes);
+    return (bool)file.write((const char*)rows.data, rows.rows * rowBytes);
+}
+
+MappedImage::MappedImage() : mapping(nullptr), mappingSize(0) {
+#if defined(_WIN32)
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    fileDescriptor = -1;
+#endif
+}
+
+MappedImage::~MappedImage() {
+    close();
+}
+
+bool MappedImage::open(const String& path) {
+    ifstream file(path, ios::binary);
+    ImageFileHeader header;
+    if (!file || !readImageHeader(file, header)) {
+        return false;
+    }
+    file.close();
+
+    if (!openRaw(path, header.rows, header.cols, header.type, header.dataOffset)) {
+        return false;
+    }
+    fileHeader.format = header.format;
+    return true;
+}
+
+bool MappedImage::openRaw(const String& path, const int rows, const int cols, const int type, const streamoff offset) {
+    close();
+    if (!map(path, false, 0)) {
+        return false;
+    }
+
+    // The file must hold all the pixels the caller expects
+    const size_t imageBytes = (size_t)rows * cols * CV_ELEM_SIZE(type);
+    if (offset < 0 || (size_t)offset + imageBytes > mappingSize) {
+        close();
+        return false;
+    }
+
+    fileHeader.format = FORMAT_RAW;
+    fileHeader.rows = rows;
+    fileHeader.cols = cols;
+    fileHeader.type = type;
+    fileHeader.dataOffset = offset;
+    view = Mat(rows, cols, type, mapping + offset);
+    return true;
+}
+
+bool MappedImage::create(const String& path, const ImageFileHeader& header) {
+    close();
+
+    // Build the header text first, its length is the offset of the pixels
+    ostringstream headerText;
+    ImageFileHeader newHeader = header;
+    newHeader.dataOffset = 0;
+    if (!writeImageHeader(headerText, newHeader)) {
+        return false;
+    }
+    const string text = headerText.str();
+    const size_t imageBytes = (size_t)header.rows * header.cols * CV_ELEM_SIZE(header.type);
+
+    if (!map(path, true, text.size() + imageBytes)) {
+        return false;
+    }
+    memcpy(mapping, text.data(), text.size());
+
+    fileHeader = newHeader;
+    fileHeader.dataOffset = (streamoff)text.size();
+    view = Mat(header.rows, header.cols, header.type, mapping + text.size());
+    return true;
+}
+
+void MappedImage::close() {
+    view = Mat();
+#if defined(_WIN32)
+    if (mapping != nullptr) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle((HANDLE)mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle((HANDLE)fileHandle);
+    }
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+    }
+    fileDescriptor = -1;
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+// Map the whole file. A writable mapping first resizes the file to size bytes, a read-only one uses the file size.
+bool MappedImage::map(const String& path, const bool writable, const size_t size) {
+#if defined(_WIN32)
+    fileHandle = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+        writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (writable) {
+        fileSize.QuadPart = (LONGLONG)size;
+    }
+    else if (!GetFileSizeEx((HANDLE)fileHandle, &fileSize)) {
+        close();
+        return false;
+    }
+    mappingSize = (size_t)fileSize.QuadPart;
+    if (mappingSize == 0) {
+        close();
+        return false;
+    }
+
+    mappingHandle = CreateFileMappingA((HANDLE)fileHandle, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, fileSize.HighPart, fileSize.LowPart, nullptr);
+    if (mappingHandle == nullptr) {
+        close();
+        return false;
+    }
+    mapping = (uchar*)MapViewOfFile((HANDLE)mappingHandle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, mappingSize);
+#else
+    fileDescriptor = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    if (writable) {
+        if (ftruncate(fileDescriptor, (off_t)size) != 0) {
+            close();
+            return false;
+        }
+        mappingSize = size;
+    }
+    else {
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) != 0) {
+            close();
+            return false;
+        }
+        mappingSize = (size_t)fileStatus.st_size;
+    }
+    if (mappingSize == 0) {
+        close();
+        return false;
+    }
+
+    void* address = mmap(nullptr, mappingSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    mapping = address == MAP_FAILED ? nullptr : (uchar*)address;
+#endif
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
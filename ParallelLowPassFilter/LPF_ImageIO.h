@@ -0,0 +1,75 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+
+enum ImageFileFormat
+{
+	FORMAT_RAW, // Pixels only, the size and type come from the caller
+	FORMAT_PGM, // Binary PGM (P5) with a maximum value of 255
+	FORMAT_PFM  // Little-endian PFM (Pf or PF), rows are stored bottom to top
+};
+
+// Uncompressed image files that can be read and written a few rows at a time, or mapped into memory
+struct ImageFileHeader
+{
+	ImageFileFormat format = FORMAT_PGM;
+	int rows = 0;
+	int cols = 0;
+	int type = CV_8UC1;
+	std::streamoff dataOffset = 0; // Offset of the first pixel in the file
+};
+
+bool readImageHeader(std::istream& file, ImageFileHeader& header);
+bool writeImageHeader(std::ostream& file, ImageFileHeader& header); // Also sets header.dataOffset
+
+// Read or write rows [firstRow, firstRow + rows.rows) of the image as stored in the file, the Mat must be continuous
+bool readImageRows(std::istream& file, const ImageFileHeader& header, const int firstRow, cv::Mat& rows);
+bool writeImageRows(std::ostream& file, const ImageFileHeader& header, const int firstRow, const cv::Mat& rows);
+
+// An image file mapped into memory. mat() is a view straight onto the mapped pages, so filtering it does not
+// decode or copy the file. Files opened for reading are mapped read-only and must not be written through mat().
+//
+// PFM rows are stored bottom to top and mat() shows them in that order. The low pass filter is symmetric, so
+// filtering the stored order and writing it to another PFM gives the same image as filtering the flipped one.
+class MappedImage
+{
+public:
+	MappedImage();
+	~MappedImage();
+	MappedImage(const MappedImage&) = delete;
+	MappedImage& operator=(const MappedImage&) = delete;
+
+	// Map an existing PGM or PFM file for reading
+	bool open(const cv::String& path);
+
+	// Map an existing raw file for reading, the pixels start at offset
+	bool openRaw(const cv::String& path, const int rows, const int cols, const int type, const std::streamoff offset);
+
+	// Create a file of the size the header describes and map it for writing
+	bool create(const cv::String& path, const ImageFileHeader& header);
+
+	// Unmap the file, pending writes are flushed by the OS
+	void close();
+
+	bool isOpen() const { return mapping != nullptr; }
+	const ImageFileHeader& header() const { return fileHeader; }
+	cv::Mat& mat() { return view; }
+	const cv::Mat& mat() const { return view; }
+
+private:
+	bool map(const cv::String& path, const bool writable, const size_t size);
+
+	ImageFileHeader fileHeader;
+	cv::Mat view;
+	uchar* mapping;
+	size_t mappingSize;
+#if defined(_WIN32)
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
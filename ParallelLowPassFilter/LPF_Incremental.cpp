@@ -0,0 +1,89 @@
+#include "LPF_Incremental.h"
+
+using namespace cv;
+using namespace std;
+
+IncrementalLowPassFilter::IncrementalLowPassFilter(const Mat& image, const FilterKernel& kernel, const int num_of_threads, const int borderType)
+    : filterKernel(kernel), threads(num_of_threads), border(borderType) {
+    // Keep a copy, the output around a change is refiltered from the pixels next to it as well
+    inputImage = image.clone();
+    outputImage = openMPLowPassFilter(inputImage, filterKernel, threads, border);
+}
+
+IncrementalLowPassFilter::IncrementalLowPassFilter(const Mat& image, const int kernelSize, const int num_of_threads)
+    : IncrementalLowPassFilter(image, FilterKernel::box(kernelSize), num_of_threads) {
+}
+
+vector<Rect> IncrementalLowPassFilter::affectedRects(const vector<Rect>& changedRects, const Size& imageSize, const int kernelSize, const int borderType) {
+    const int paddingSize = kernelSize / 2;
+    const Rect image(Point(0, 0), imageSize);
+
+    // A changed pixel is read by the outputs at most paddingSize away. The other borders only read pixels that are
+    // already that close through the border, a wrapped one also reads them from the other side of the image.
+    vector<Rect> rects;
+    for (const Rect& changed : changedRects) {
+        if ((changed & image).empty()) {
+            continue;
+        }
+        const Rect grown(changed.x - paddingSize, changed.y - paddingSize, changed.width + 2 * paddingSize, changed.height + 2 * paddingSize);
+        const int shifts = borderType == BORDER_WRAP ? 1 : 0;
+        for (int dy = -shifts; dy <= shifts; dy++) {
+            for (int dx = -shifts; dx <= shifts; dx++) {
+                const Rect part = (grown + Point(dx * imageSize.width, dy * imageSize.height)) & image;
+                if (!part.empty()) {
+                    rects.push_back(part);
+                }
+            }
+        }
+    }
+
+    // Merge overlapping rectangles into their bounding box until none overlap, so no output pixel is filtered
+    // twice or written by two threads
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size() && !merged; j++) {
+                if (!(rects[i] & rects[j]).empty()) {
+                    rects[i] |= rects[j];
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+    }
+    return rects;
+}
+
+const Mat& IncrementalLowPassFilter::update(const Mat& image, const vector<Rect>& changedRects) {
+    CV_Assert(image.size() == inputImage.size() && image.type() == inputImage.type());
+    const Rect imageRect(0, 0, inputImage.cols, inputImage.rows);
+    for (const Rect& changed : changedRects) {
+        const Rect part = changed & imageRect;
+        if (!part.empty()) {
+            Mat inputPart = inputImage(part);
+            image(part).copyTo(inputPart);
+        }
+    }
+    return update(changedRects);
+}
+
+const Mat& IncrementalLowPassFilter::update(const vector<Rect>& changedRects) {
+    dirtyRects = affectedRects(changedRects, inputImage.size(), filterKernel.size(), border);
+
+    // The tiles of all rectangles go into one parallel loop, so many small changes still keep every thread busy
+    vector<Rect> tiles;
+    for (const Rect& rect : dirtyRects) {
+        vector<Rect> rectTiles = makeTiles(rect, filterKernel.size(), threads, inputImage.type());
+        tiles.insert(tiles.end(), rectTiles.begin(), rectTiles.end());
+    }
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (int t = 0; t < (int)tiles.size(); t++) {
+        TraceScope scope("tile");
+        Mat outputTile = outputImage(tiles[t]);
+        kernelLowPassFilter(inputImage, outputTile, filterKernel, tiles[t], border);
+    }
+
+    return outputImage;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utils/logger.hpp>
+
+#include "LPF_OpenMP.h"
+
+// Keeps an image and its filtered output between calls, for images that change in small areas such as the frames
+// of an interactive or streaming view. An update refilters only the output pixels whose kernel reaches a changed
+// pixel, so its cost grows with the changed area rather than with the image.
+class IncrementalLowPassFilter
+{
+public:
+	// Filter the first image in full. The kernelSize version filters with the box kernel and a zero border.
+	IncrementalLowPassFilter(const cv::Mat& image, const FilterKernel& kernel, const int num_of_threads = 1, const int borderType = cv::BORDER_CONSTANT);
+	IncrementalLowPassFilter(const cv::Mat& image, const int kernelSize, const int num_of_threads = 1);
+
+	// The pixels of image inside changedRects differ from the last image. Copy them, refilter the output around
+	// them and return the whole output. image has the size and type of the first image.
+	const cv::Mat& update(const cv::Mat& image, const std::vector<cv::Rect>& changedRects);
+
+	// The same after the caller wrote the changed pixels into input() itself
+	const cv::Mat& update(const std::vector<cv::Rect>& changedRects);
+
+	cv::Mat& input() { return inputImage; }
+	const cv::Mat& output() const { return outputImage; }
+
+	// The output rectangles the last update refiltered, which never overlap
+	const std::vector<cv::Rect>& updatedRects() const { return dirtyRects; }
+
+	// The output rectangles a change of changedRects reaches: every rectangle grown by kernelSize / 2, clipped to
+	// the image or, with a wrapped border, wrapped around it, and overlapping ones merged into one
+	static std::vector<cv::Rect> affectedRects(const std::vector<cv::Rect>& changedRects, const cv::Size& imageSize, const int kernelSize, const int borderType);
+
+private:
+	FilterKernel filterKernel;
+	int threads;
+	int border;
+	cv::Mat inputImage;
+	cv::Mat outputImage;
+	std::vector<cv::Rect> dirtyRects;
+};
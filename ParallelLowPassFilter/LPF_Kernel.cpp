@@ -0,0 +1,432 @@
+#include "LPF_Kernel.h"
+
+using namespace cv;
+using namespace std;
+
+FilterKernel::FilterKernel(const Mat& weights, const bool isBoxKernel) : boxKernel(isBoxKernel) {
+    CV_Assert(weights.channels() == 1 && weights.rows == weights.cols && weights.rows % 2 == 1);
+    weights.convertTo(kernelWeights, CV_32F);
+}
+
+FilterKernel FilterKernel::box(const int kernelSize) {
+    CV_Assert(kernelSize > 0 && kernelSize % 2 == 1);
+    return FilterKernel(Mat(kernelSize, kernelSize, CV_32FC1, Scalar::all(1.0 / ((double)kernelSize * kernelSize))), true);
+}
+
+FilterKernel FilterKernel::gaussian(const int kernelSize, const double sigma) {
+    CV_Assert(kernelSize > 0 && kernelSize % 2 == 1);
+    const int paddingSize = kernelSize / 2;
+    const double spread = sigma > 0 ? sigma : 0.3 * ((kernelSize - 1) * 0.5 - 1) + 0.8;
+
+    // The 2D Gaussian is the product of two 1D ones, so its factors are known without an SVD
+    vector<double> profile(kernelSize);
+    double total = 0;
+    for (int i = 0; i < kernelSize; i++) {
+        profile[i] = exp(-(double)(i - paddingSize) * (i - paddingSize) / (2 * spread * spread));
+        total += profile[i];
+    }
+
+    Mat weights(kernelSize, kernelSize, CV_32FC1);
+    vector<float> factor(kernelSize);
+    for (int i = 0; i < kernelSize; i++) {
+        factor[i] = (float)(profile[i] / total);
+    }
+    for (int i = 0; i < kernelSize; i++) {
+        for (int j = 0; j < kernelSize; j++) {
+            weights.at<float>(i, j) = factor[i] * factor[j];
+        }
+    }
+
+    FilterKernel kernel(weights, false);
+    if (kernelSize > 1) {
+        kernel.rowFactors.push_back(factor);
+        kernel.columnFactors.push_back(factor);
+    }
+    return kernel;
+}
+
+FilterKernel FilterKernel::custom(const Mat& weights) {
+    FilterKernel kernel(weights, false);
+    const Mat& w = kernel.kernelWeights;
+    const int kernelSize = kernel.size();
+
+    // A uniform kernel that sums to one is the box, which the running sums filter exactly and faster
+    bool uniform = true;
+    for (int i = 0; i < kernelSize && uniform; i++) {
+        for (int j = 0; j < kernelSize && uniform; j++) {
+            uniform = w.at<float>(i, j) == w.at<float>(0, 0);
+        }
+    }
+    if (uniform && fabs(w.at<float>(0, 0) * (double)kernelSize * kernelSize - 1) < 1e-6) {
+        return box(kernelSize);
+    }
+
+    // weights = U * diag(s) * Vt = sum of s[i] * u[i] * vt[i] over the singular values. Terms below a millionth of
+    // the largest one are rounding noise of the SVD. Every term costs 2 * kernelSize multiplies per pixel against
+    // kernelSize * kernelSize for the direct loop, so the factors are only kept when they are cheaper.
+    Mat singularValues, u, vt;
+    SVD::compute(w, singularValues, u, vt);
+    const double largest = singularValues.at<double>(0, 0);
+    int terms = 0;
+    while (terms < singularValues.rows && singularValues.at<double>(terms, 0) > largest * 1e-6) {
+        terms++;
+    }
+
+    if (largest > 0 && 2 * terms < kernelSize) {
+        for (int t = 0; t < terms; t++) {
+            // Split the singular value evenly between the two factors
+            const double scale = sqrt(singularValues.at<double>(t, 0));
+            vector<float> rowFactor(kernelSize), columnFactor(kernelSize);
+            for (int i = 0; i < kernelSize; i++) {
+                columnFactor[i] = (float)(u.at<double>(i, t) * scale);
+                rowFactor[i] = (float)(vt.at<double>(t, i) * scale);
+            }
+            kernel.rowFactors.push_back(rowFactor);
+            kernel.columnFactors.push_back(columnFactor);
+        }
+    }
+    return kernel;
+}
+
+// sums[i] += the weighted input row around output value i, for width pixels of channels values starting at
+// firstColumn. Every output value adds up the same products in the same order whatever the region is, so tiles
+// and blocks give the same bits as one pass over the whole image.
+template <typename T>
+static void correlateRow(float* sums, const T* inputRow, const int inputCols, const int firstColumn, const int width, const int channels, const float* weights, const int kernelSize, const int borderType) {
+    const int paddingSize = kernelSize / 2;
+    for (int b = 0; b < kernelSize; b++) {
+        const float weight = weights[b];
+        if (weight == 0) {
+            continue;
+        }
+
+        // Output pixel o reads input column offset + o, pixels [begin, end) read inside the input
+        const int offset = firstColumn + b - paddingSize;
+        const int begin = min(max(-offset, 0), width);
+        const int end = max(min(width, inputCols - offset), begin);
+        const int shift = offset * channels;
+        for (int i = begin * channels; i < end * channels; i++) {
+            sums[i] += weight * (float)inputRow[shift + i];
+        }
+
+        // The few pixels at the image edges read the column the border maps them to, if any
+        auto addBorderPixel = [&](const int o) {
+            const int source = borderInterpolate(offset + o, inputCols, borderType);
+            if (source >= 0) {
+                for (int c = 0; c < channels; c++) {
+                    sums[o * channels + c] += weight * (float)inputRow[source * channels + c];
+                }
+            }
+        };
+        for (int o = 0; o < begin; o++) {
+            addBorderPixel(o);
+        }
+        for (int o = end; o < width; o++) {
+            addBorderPixel(o);
+        }
+    }
+}
+
+// correlateRow for a kernel of K columns known when compiling. The K taps of every output value are unrolled and
+// summed in a register, in the order correlateRow adds them, so the specializations give the same bits as the
+// loops for any size on finite pixels. The values whose taps all lie inside the input take one loop without a branch, the few at
+// the image edges read through the border.
+template <typename T, int K>
+static void correlateRowFixed(float* __restrict sums, const T* inputRow, const int inputCols, const int firstColumn, const int width, const int channels, const float* weights, const int borderType) {
+    const int paddingSize = K / 2;
+    float taps[K];
+    copy(weights, weights + K, taps);
+
+    // Output pixel o reads input columns firstColumn + o - paddingSize to firstColumn + o + paddingSize
+    const int begin = min(max(paddingSize - firstColumn, 0), width);
+    const int end = max(min(width, inputCols - paddingSize - firstColumn), begin);
+    const T* input = inputRow + (firstColumn - paddingSize) * channels;
+    for (int i = begin * channels; i < end * channels; i++) {
+        float sum = sums[i];
+        for (int b = 0; b < K; b++) {
+            sum += taps[b] * (float)input[i + b * channels];
+        }
+        sums[i] = sum;
+    }
+
+    auto addBorderPixel = [&](const int o) {
+        for (int b = 0; b < K; b++) {
+            const int source = borderInterpolate(firstColumn + o + b - paddingSize, inputCols, borderType);
+            if (taps[b] == 0 || source < 0) {
+                continue;
+            }
+            for (int c = 0; c < channels; c++) {
+                sums[o * channels + c] += taps[b] * (float)inputRow[source * channels + c];
+            }
+        }
+    };
+    for (int o = 0; o < begin; o++) {
+        addBorderPixel(o);
+    }
+    for (int o = end; o < width; o++) {
+        addBorderPixel(o);
+    }
+}
+
+// sums[i] += the K rows weighted and added up in a register, in the order of the column loop of the separable pass
+template <int K>
+static void combineRowsFixed(float* __restrict sums, const float* const* inputRows, const float* weights, const int count) {
+    const float* rows[K];
+    float taps[K];
+    copy(inputRows, inputRows + K, rows);
+    copy(weights, weights + K, taps);
+    for (int j = 0; j < count; j++) {
+        float sum = sums[j];
+        for (int a = 0; a < K; a++) {
+            sum += taps[a] * rows[a][j];
+        }
+        sums[j] = sum;
+    }
+}
+
+// Round and saturate integer outputs, like filter2D
+template <typename T>
+static void storeRow(T* outputRow, const float* sums, const int count) {
+    for (int i = 0; i < count; i++) {
+        outputRow[i] = saturate_cast<T>(sums[i]);
+    }
+}
+
+// Two passes per rank-1 term: every input row is filtered with the row factor once, into a ring of the last
+// kernelSize results per term, and every output row is the column factor applied down the ring. Rows outside the
+// input are filtered from the row the border maps them to, or skipped with a constant border. K is the kernel size
+// when it is known when compiling, 0 otherwise.
+template <typename T, int K>
+static void separableFilterRegion(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int borderType, FilterScratch& scratch) {
+    const int kernelSize = K > 0 ? K : kernel.size();
+    const int paddingSize = kernelSize / 2;
+    const int channels = inputImage.channels();
+    const int rowLength = region.width * channels;
+    const int terms = kernel.separableTerms();
+
+    float* ring = scratch.buffer<float>(0, (size_t)terms * kernelSize * rowLength);
+    float* sums = scratch.buffer<float>(1, rowLength);
+    auto ringRow = [&](const int term, const int y) {
+        return ring + ((size_t)term * kernelSize + (y % kernelSize + kernelSize) % kernelSize) * rowLength;
+    };
+    auto rowPass = [&](const int y) {
+        const int source = borderInterpolate(y, inputImage.rows, borderType);
+        if (source < 0) {
+            return;
+        }
+        for (int t = 0; t < terms; t++) {
+            float* filteredRow = ringRow(t, y);
+            fill(filteredRow, filteredRow + rowLength, 0.0f);
+            const T* inputRow = inputImage.ptr<T>(source);
+            const float* rowFactor = kernel.rowFactor(t).data();
+            if (K > 0) {
+                correlateRowFixed<T, K>(filteredRow, inputRow, inputImage.cols, region.x, region.width, channels, rowFactor, borderType);
+            }
+            else {
+                correlateRow(filteredRow, inputRow, inputImage.cols, region.x, region.width, channels, rowFactor, kernelSize, borderType);
+            }
+        }
+    };
+
+    // Prime the ring with the rows above the first output row
+    for (int y = region.y - paddingSize; y < region.y + paddingSize; y++) {
+        rowPass(y);
+    }
+
+    for (int i = 0; i < region.height; i++) {
+        const int y = region.y + i;
+        rowPass(y + paddingSize);
+
+        fill(sums, sums + rowLength, 0.0f);
+
+        // Rows away from a constant border have all their input rows, and take the unrolled column loop
+        const bool allRows = borderType != BORDER_CONSTANT || (y >= paddingSize && y + paddingSize < inputImage.rows);
+        if (K > 0 && allRows) {
+            const float* filteredRows[K > 0 ? K : 1];
+            for (int t = 0; t < terms; t++) {
+                for (int a = 0; a < kernelSize; a++) {
+                    filteredRows[a] = ringRow(t, y + a - paddingSize);
+                }
+                combineRowsFixed<K>(sums, filteredRows, kernel.columnFactor(t).data(), rowLength);
+            }
+            storeRow(outputImage.ptr<T>(i), sums, rowLength);
+            continue;
+        }
+
+        for (int t = 0; t < terms; t++) {
+            const vector<float>& columnFactor = kernel.columnFactor(t);
+            for (int a = 0; a < kernelSize; a++) {
+                const int inputRow = y + a - paddingSize;
+                if (columnFactor[a] == 0 || borderInterpolate(inputRow, inputImage.rows, borderType) < 0) {
+                    continue;
+                }
+                const float weight = columnFactor[a];
+                const float* filteredRow = ringRow(t, inputRow);
+                for (int j = 0; j < rowLength; j++) {
+                    sums[j] += weight * filteredRow[j];
+                }
+            }
+        }
+        storeRow(outputImage.ptr<T>(i), sums, rowLength);
+    }
+}
+
+// Every output row adds up the kernel rows applied to the input rows around it. The OpenMP tiles keep the input
+// rows of a tile in cache while its kernelSize * kernelSize products per pixel are summed.
+template <typename T, int K>
+static void directFilterRegion(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int borderType, FilterScratch& scratch) {
+    const int kernelSize = K > 0 ? K : kernel.size();
+    const int paddingSize = kernelSize / 2;
+    const int channels = inputImage.channels();
+    const int rowLength = region.width * channels;
+    float* sums = scratch.buffer<float>(0, rowLength);
+
+    for (int i = 0; i < region.height; i++) {
+        const int y = region.y + i;
+        fill(sums, sums + rowLength, 0.0f);
+        for (int a = 0; a < kernelSize; a++) {
+            const int source = borderInterpolate(y + a - paddingSize, inputImage.rows, borderType);
+            if (source < 0) {
+                continue;
+            }
+            if (K > 0) {
+                correlateRowFixed<T, K>(sums, inputImage.ptr<T>(source), inputImage.cols, region.x, region.width, channels, kernel.weights().ptr<float>(a), borderType);
+            }
+            else {
+                correlateRow(sums, inputImage.ptr<T>(source), inputImage.cols, region.x, region.width, channels, kernel.weights().ptr<float>(a), kernelSize, borderType);
+            }
+        }
+        storeRow(outputImage.ptr<T>(i), sums, rowLength);
+    }
+}
+
+template <typename T, int K>
+static void kernelFilterRegion(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int borderType, FilterScratch& scratch) {
+    if (kernel.isSeparable()) {
+        separableFilterRegion<T, K>(inputImage, outputImage, kernel, region, borderType, scratch);
+    }
+    else {
+        directFilterRegion<T, K>(inputImage, outputImage, kernel, region, borderType, scratch);
+    }
+}
+
+typedef void (*KernelRegionFilter)(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int borderType, FilterScratch& scratch);
+
+// The filters by pixel depth (8U, 16U, 32F) and kernel size: the loops for any size, then the sizes most images
+// are filtered with, 3, 5, 7 and 9, whose loops the compiler unrolls
+static const KernelRegionFilter kernelRegionFilters[3][5] = {
+    { kernelFilterRegion<uchar, 0>, kernelFilterRegion<uchar, 3>, kernelFilterRegion<uchar, 5>, kernelFilterRegion<uchar, 7>, kernelFilterRegion<uchar, 9> },
+    { kernelFilterRegion<ushort, 0>, kernelFilterRegion<ushort, 3>, kernelFilterRegion<ushort, 5>, kernelFilterRegion<ushort, 7>, kernelFilterRegion<ushort, 9> },
+    { kernelFilterRegion<float, 0>, kernelFilterRegion<float, 3>, kernelFilterRegion<float, 5>, kernelFilterRegion<float, 7>, kernelFilterRegion<float, 9> },
+};
+
+static KernelRegionFilter kernelRegionFilter(const int depth, const int kernelSize) {
+    const int depthIndex = depth == CV_8U ? 0 : depth == CV_16U ? 1 : 2;
+    const int sizeIndex = kernelSize >= 3 && kernelSize <= 9 ? kernelSize / 2 : 0;
+    return kernelRegionFilters[depthIndex][sizeIndex];
+}
+
+void kernelLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int borderType, FilterScratch& scratch) {
+    if (kernel.isBox()) {
+        boxLowPassFilter(inputImage, outputImage, kernel.size(), region, borderType, scratch);
+        return;
+    }
+
+    CV_Assert(isBoxFilterType(inputImage.type()) && outputImage.type() == inputImage.type());
+    CV_Assert(isBorderType(borderType));
+    CV_Assert(outputImage.size() == region.size());
+    if (region.empty()) {
+        return;
+    }
+
+    kernelRegionFilter(inputImage.depth(), kernel.size())(inputImage, outputImage, kernel, region, borderType, scratch);
+}
+
+Mat kernelLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int borderType) {
+    // Create an output image with the same size as the input image
+    Mat outputImage(inputImage.size(), inputImage.type());
+
+    kernelLowPassFilter(inputImage, outputImage, kernel, Rect(0, 0, inputImage.cols, inputImage.rows), borderType);
+
+    return outputImage;
+}
+
+void fillWindowBorder(Mat& window, const Point& origin, const Size& imageSize, const int borderType) {
+    const size_t pixelSize = window.elemSize();
+
+    // Columns first, on every row, so the rows copied next already carry their border columns and the corners
+    // come out right. Rows of wrapped halos that were received get their border columns here as well.
+    for (int x = 0; x < window.cols; x++) {
+        if (origin.x + x >= 0 && origin.x + x < imageSize.width) {
+            continue;
+        }
+        const int mapped = borderInterpolate(origin.x + x, imageSize.width, borderType);
+        const int source = mapped - origin.x;
+        if (mapped < 0) {
+            for (int y = 0; y < window.rows; y++) {
+                memset(window.ptr(y) + x * pixelSize, 0, pixelSize);
+            }
+        }
+        else if (source >= 0 && source < window.cols) {
+            for (int y = 0; y < window.rows; y++) {
+                memcpy(window.ptr(y) + x * pixelSize, window.ptr(y) + source * pixelSize, pixelSize);
+            }
+        }
+    }
+
+    for (int y = 0; y < window.rows; y++) {
+        if (origin.y + y >= 0 && origin.y + y < imageSize.height) {
+            continue;
+        }
+        const int mapped = borderInterpolate(origin.y + y, imageSize.height, borderType);
+        const int source = mapped - origin.y;
+        if (mapped < 0) {
+            memset(window.ptr(y), 0, window.cols * pixelSize);
+        }
+        else if (source >= 0 && source < window.rows) {
+            memcpy(window.ptr(y), window.ptr(source), window.cols * pixelSize);
+        }
+    }
+}
+
+void passLowPassFilter(const Mat& source, const Point& sourceOrigin, const Size& imageSize, Mat& outputImage, const Rect& target, const FilterKernel& kernel, const int passes, const int borderType, FilterScratch& scratch) {
+    CV_Assert(passes > 0 && outputImage.size() == target.size());
+    if (target.empty()) {
+        return;
+    }
+    const int paddingSize = kernel.size() / 2;
+    const Rect image(Point(0, 0), imageSize);
+
+    // Pass n of N filters the target plus (N - n) * paddingSize pixels, clipped to the image, into a window with
+    // the halo the next pass reads around it. The part of the halo outside the image is filled through the border
+    // like the distributed halos, so the next pass never needs the image. A wrapped image repeats, so its windows
+    // are not clipped and the parts outside the image are filtered like any other pixel instead.
+    const bool wrap = borderType == BORDER_WRAP;
+    const Mat* input = &source;
+    Point inputOrigin = sourceOrigin;
+    Mat windows[2];
+    for (int pass = 1; pass < passes; pass++) {
+        const int reach = (passes - pass - 1) * paddingSize;
+        Rect filtered(target.x - reach, target.y - reach, target.width + 2 * reach, target.height + 2 * reach);
+        if (!wrap) {
+            filtered &= image;
+        }
+        const Rect windowRect(filtered.x - paddingSize, filtered.y - paddingSize, filtered.width + 2 * paddingSize, filtered.height + 2 * paddingSize);
+        const Rect inside = wrap ? windowRect : windowRect & image;
+
+        // Alternate the buffers, the pass reads the one the previous pass wrote. The buffers only grow, so the ones
+        // of a thread are allocated and faulted in once.
+        Mat& window = windows[pass % 2];
+        window = scratch.image(pass % 2, windowRect.size(), source.type());
+        Mat insideOutput = window(inside - windowRect.tl());
+        kernelLowPassFilter(*input, insideOutput, kernel, inside - inputOrigin, borderType, scratch);
+        if (inside != windowRect) {
+            fillWindowBorder(window, windowRect.tl(), imageSize, borderType);
+        }
+
+        input = &window;
+        inputOrigin = windowRect.tl();
+    }
+
+    kernelLowPassFilter(*input, outputImage, kernel, target - inputOrigin, borderType, scratch);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utils/logger.hpp>
+
+#include "LPF_BoxFilter.h"
+
+// A square low-pass kernel of odd size. The weights are applied like filter2D, without flipping, and pixels
+// outside the image follow the border type as with the box filter.
+//
+// When it is built, the kernel picks how it is filtered: the uniform box uses the running sums of LPF_BoxFilter,
+// a kernel that factors into a few rank-1 terms (found with an SVD) is filtered with a row pass and a column pass
+// per term, and any other kernel with a direct 2D loop over its weights.
+class FilterKernel
+{
+public:
+	// The kernelSize x kernelSize average
+	static FilterKernel box(const int kernelSize);
+
+	// A normalized Gaussian. A sigma of zero or less is derived from the size the way getGaussianKernel does.
+	static FilterKernel gaussian(const int kernelSize, const double sigma = 0);
+
+	// Any odd square matrix of weights of any depth, used as given without normalizing it
+	static FilterKernel custom(const cv::Mat& weights);
+
+	int size() const { return kernelWeights.rows; }
+	const cv::Mat& weights() const { return kernelWeights; } // CV_32FC1
+	bool isBox() const { return boxKernel; }
+	bool isSeparable() const { return !rowFactors.empty(); }
+
+	// weights = sum of columnFactor(i) * rowFactor(i) over the terms, when the kernel is separable
+	int separableTerms() const { return (int)rowFactors.size(); }
+	const std::vector<float>& rowFactor(const int term) const { return rowFactors[term]; }
+	const std::vector<float>& columnFactor(const int term) const { return columnFactors[term]; }
+
+private:
+	FilterKernel(const cv::Mat& weights, const bool isBoxKernel);
+
+	cv::Mat kernelWeights;
+	bool boxKernel;
+	std::vector<std::vector<float>> rowFactors;
+	std::vector<std::vector<float>> columnFactors;
+};
+
+// Filter the region of the input into outputImage (of the region's size) with any kernel, for the same pixel
+// types and border types as boxLowPassFilter. Integer outputs are rounded to the nearest value and saturated.
+void kernelLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const cv::Rect& region, const int borderType = cv::BORDER_CONSTANT, FilterScratch& scratch = threadScratch());
+cv::Mat kernelLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int borderType = cv::BORDER_CONSTANT);
+
+// Fill the pixels of a window of the image that lie outside the image, where origin is the position of the
+// window's top left pixel in an image of imageSize, by copying the pixels the border maps them to, or zeros for a
+// constant border. The distributed backends call it once their halo has arrived, so the engine finds every pixel
+// it needs inside the window. Pixels that map outside the window are left as they are: wrapped halos that were
+// received from the blocks at the other end of the image.
+void fillWindowBorder(cv::Mat& window, const cv::Point& origin, const cv::Size& imageSize, const int borderType);
+
+// Filter the target (in image coordinates) with passes passes of the kernel into outputImage (of the target's
+// size), each pass reading the one before through the border as if it had filtered the whole image. source is the
+// whole image at origin (0, 0), or a window of it whose top left pixel is at sourceOrigin and that holds the target
+// plus passes * kernel.size() / 2 pixels on every side, filled in with fillWindowBorder.
+//
+// Every pass only filters the part of the window the passes after it still read, which shrinks by kernel.size() / 2
+// per pass, into one of the two image buffers of the scratch, which are kept for the next targets. A target that
+// fits in cache with its halo stays there for all passes.
+void passLowPassFilter(const cv::Mat& source, const cv::Point& sourceOrigin, const cv::Size& imageSize, cv::Mat& outputImage, const cv::Rect& target, const FilterKernel& kernel, const int passes, const int borderType, FilterScratch& scratch = threadScratch());
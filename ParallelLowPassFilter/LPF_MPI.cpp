@@ -1,51 +1,106 @@
 #include "LPF_MPI.h"
+#include <algorithm>
 
-Mat MPILowPassFilter(const Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector) {
-    // Define the filter kernel
-    float filter_value = (1 / (float)(kernelSize * kernelSize));
+using namespace cv;
+using namespace std;
 
-    // Perform zero padding on the input image
-    int paddingSize = kernelSize / 2;
-    Mat paddedImage;
-    copyMakeBorder(inputImage, paddedImage, paddingSize, paddingSize, paddingSize, paddingSize, BORDER_CONSTANT, Scalar(0));
+vector<int> MPIRowCounts(const int rows, const int world_size, const int paddingSize, const vector<double>& weights) {
+    // Every block must have at least paddingSize rows to fill the halo of its neighbours, so small images use fewer processes
+    const int minimumRows = max(paddingSize, 1);
+    const int activeSize = max(1, min(world_size, rows / minimumRows));
+    vector<int> counts(world_size, 0);
+    if (activeSize == 1) {
+        counts[0] = rows;
+        return counts;
+    }
+
+    bool weighted = (int)weights.size() >= activeSize;
+    double totalWeight = 0;
+    for (int i = 0; i < activeSize && weighted; i++) {
+        weighted = weights[i] > 0;
+        totalWeight += weights[i];
+    }
+
+    if (!weighted) {
+        // Blocks differ by at most one row, the first ones get the leftover
+        for (int i = 0; i < activeSize; i++) {
+            counts[i] = rows / activeSize + (i < rows % activeSize ? 1 : 0);
+        }
+        return counts;
+    }
 
-    // Calculate the local dimensions and offset for each process
-    int localHeight = paddedImage.rows / world_size;
-    int localWidth = paddedImage.cols;
-    int leftOver = paddedImage.rows % world_size;
+    // Every block gets its minimum, the other rows are shared in proportion to the weights, and the rows left over
+    // by rounding down go to the largest remainders. Every process gets the same counts from the same weights.
+    const int spareRows = rows - activeSize * minimumRows;
+    int assigned = 0;
+    vector<double> remainders(activeSize);
+    for (int i = 0; i < activeSize; i++) {
+        const double share = spareRows * weights[i] / totalWeight;
+        const int wholeRows = min((int)share, spareRows - assigned);
+        counts[i] = minimumRows + wholeRows;
+        assigned += wholeRows;
+        remainders[i] = share - wholeRows;
+    }
+    vector<int> order(activeSize);
+    for (int i = 0; i < activeSize; i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&](const int a, const int b) { return remainders[a] > remainders[b]; });
+    for (int i = 0; assigned < spareRows; i = (i + 1) % activeSize) {
+        counts[order[i]]++;
+        assigned++;
+    }
+    return counts;
+}
 
-    int prevRank = world_rank - 1;
-    int nextRank = world_rank + 1;
+// MPILowPassFilter for any split of the rows between the processes. rowCounts holds the rows of every process of
+// comm, at least paddingSize for the first processes and zero for the rest. With timing, the process reports how
+// long it filtered its rows.
+static void filterRowBlocks(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const vector<int>& rowCounts, const int world_size, const int world_rank, const int collector, const MPI_Comm comm, const int borderType, MPIRankTiming* timing) {
+    CV_Assert(passes > 0 && (int)rowCounts.size() == world_size);
+    auto start_time = chrono::high_resolution_clock::now();
+    double filterSeconds = 0;
+
+    // The rows above and below each block come from the neighbouring processes, or from the border at the image
+    // edges. Every pass reads kernel.size() / 2 rows further, so one halo for all passes is that many rows per pass.
+    int paddingSize = passes * (kernel.size() / 2);
+
+    // The processes with rows come first
+    int activeSize = 0;
+    while (activeSize < world_size && rowCounts[activeSize] > 0) {
+        activeSize++;
+    }
+    activeSize = max(activeSize, 1);
+    int localWidth = inputImage.cols;
 
-    // Perform convolution on the local image block using the filter kernel
-    Mat aboveRows = Mat::zeros(paddingSize, localWidth, CV_8UC1);
-    Mat belowRows = Mat::zeros(paddingSize, localWidth, CV_8UC1);
+    // Counts are in bytes so any pixel type and channel count is sent as is
+    int rowSize = localWidth * (int)inputImage.elemSize();
+
+    // With a wrapped border the first and last blocks are neighbours as well
+    const bool wrap = borderType == BORDER_WRAP && activeSize > 1;
+    int prevRank = world_rank > 0 ? world_rank - 1 : (wrap ? activeSize - 1 : -1);
+    int nextRank = world_rank < activeSize - 1 ? world_rank + 1 : (wrap ? 0 : world_size);
 
     // Scatter the input image to all processes
     int* sendcounts = new int[world_size];
     int* displs = new int[world_size];
 
-    // Calculate the sendcounts and displacements
+    // Calculate the sendcounts and displacements, the blocks follow each other in rank order
+    int firstRowOfRank = 0;
     for (int i = 0; i < world_size; i++) {
-        sendcounts[i] = localHeight * localWidth;
-        displs[i] = i * localHeight * localWidth;
-
-        if (i < leftOver) {
-            sendcounts[i] += localWidth;
-            displs[i] +=  (i * localWidth);
-        }
-        else {
-            displs[i] += (leftOver * localWidth);
-        }
+        sendcounts[i] = rowCounts[i] * rowSize;
+        displs[i] = firstRowOfRank * rowSize;
+        firstRowOfRank += rowCounts[i];
     }
+    CV_Assert(firstRowOfRank == inputImage.rows);
 
-    // Fix the local height according to leftover distribution
-    if (world_rank < leftOver) {
-        localHeight += 1;
-    }
+    int localHeight = rowCounts[world_rank];
 
-    // Allocate memory for the local image block and the output block
-    Mat localImage(localHeight, localWidth, inputImage.type());
+    // Allocate memory for the local image block with room for the rows above and below it, and the output block
+    Mat localWindow = Mat::zeros(localHeight + 2 * paddingSize, localWidth, inputImage.type());
+    Mat aboveRows = localWindow.rowRange(0, paddingSize);
+    Mat localImage = localWindow.rowRange(paddingSize, paddingSize + localHeight);
+    Mat belowRows = localWindow.rowRange(paddingSize + localHeight, localHeight + 2 * paddingSize);
     Mat localOutputImage(localHeight, localWidth, inputImage.type());
 
     // Debugging print
@@ -59,104 +114,330 @@ Mat MPILowPassFilter(const Mat& inputImage, const int kernelSize, const int worl
     //fflush(stdout);
 
 
-    // Scatter the input image to all processes
-    MPI_Scatterv(paddedImage.data, sendcounts, displs, MPI_UNSIGNED_CHAR, localImage.data, localHeight * localWidth, MPI_UNSIGNED_CHAR, collector, MPI_COMM_WORLD);
+    // Scatter the input image to all processes, straight from the caller's buffer when it is continuous (e.g. a mapped file)
+    Mat sendImage;
+    if (world_rank == collector) {
+        sendImage = inputImage.isContinuous() ? inputImage : inputImage.clone();
+    }
+    TraceScope scatterScope("scatter");
+    MPI_Scatterv(sendImage.data, sendcounts, displs, MPI_BYTE, localImage.data, localHeight * rowSize, MPI_BYTE, collector, comm);
+    scatterScope.end();
 
-    // Send the top and bottom rows to the previous and next processes
-    if (world_size > 1) {
+    // Post the exchange of the top and bottom rows with the previous and next processes without waiting for it.
+    // Rows going up are tagged 1 and rows going down 2, which tells them apart when both neighbours are the same
+    // process, as with two blocks and a wrapped border.
+    MPI_Request requests[4];
+    int requestCount = 0;
+    if (world_size > 1 && localHeight > 0) {
         if (prevRank >= 0) {
-            MPI_Request request;
-            MPI_Isend(localImage.rowRange(0, paddingSize).data, paddingSize * localWidth, MPI_UNSIGNED_CHAR, prevRank, 0, MPI_COMM_WORLD, &request);
-            MPI_Recv(aboveRows.data, paddingSize * localWidth, MPI_UNSIGNED_CHAR, prevRank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Irecv(aboveRows.data, paddingSize * rowSize, MPI_BYTE, prevRank, 2, comm, &requests[requestCount++]);
+            MPI_Isend(localImage.rowRange(0, paddingSize).data, paddingSize * rowSize, MPI_BYTE, prevRank, 1, comm, &requests[requestCount++]);
         }
 
         if (nextRank <= world_size - 1) {
-            MPI_Request request2;
-            MPI_Isend(localImage.rowRange(localHeight - paddingSize, localHeight).data, paddingSize * localWidth, MPI_UNSIGNED_CHAR, nextRank, 0, MPI_COMM_WORLD, &request2);
-            MPI_Recv(belowRows.data, paddingSize * localWidth, MPI_UNSIGNED_CHAR, nextRank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Irecv(belowRows.data, paddingSize * rowSize, MPI_BYTE, nextRank, 1, comm, &requests[requestCount++]);
+            MPI_Isend(localImage.rowRange(localHeight - paddingSize, localHeight).data, paddingSize * rowSize, MPI_BYTE, nextRank, 2, comm, &requests[requestCount++]);
         }
     }
 
-    // Perform convolution on the local image block using the filter kernel
-    for (int i = 0; i < localHeight; i++) {
-        for (int j = paddingSize; j < localWidth - paddingSize; j++) {
-            float sum = 0.0;
-            for (int k = -paddingSize; k <= paddingSize; k++) {
-                for (int l = -paddingSize; l <= paddingSize; l++) {
-                    if ((i + k >= 0) && (i + k < localHeight) && (j + l >= 0) && (j + l < localWidth)) {
-                        float pixelValue = localImage.at<uchar>(i + k, j + l);
-                        sum += pixelValue * filter_value;
-                    }
-                    else if (i + k < 0) {
-                        int index = ((i + k) + paddingSize) % paddingSize;
-                        sum += aboveRows.at<uchar>(index, j + l) * filter_value; // First row - access above block
-                    }
-                    else if (i + k >= localHeight) {
-                        int index = ((i + k - localHeight) + paddingSize) % paddingSize;
-                        sum += belowRows.at<uchar>(index, j + l) * filter_value;// Last row - access below block
-                    }
-                }
-            }
-            localOutputImage.at<uchar>(i, j) = sum;
-        }
+    // While the rows are in flight, filter the interior rows whose passes do not reach the rows above or below the
+    // block. The window is in image coordinates from its first row, and its tiles go through all passes in cache.
+    int firstRow = displs[world_rank] / rowSize;
+    Point windowOrigin(0, firstRow - paddingSize);
+    int interiorBegin = min(paddingSize, localHeight);
+    int interiorEnd = max(localHeight - paddingSize, interiorBegin);
+    Mat interiorOutput = localOutputImage.rowRange(interiorBegin, interiorEnd);
+    auto filter_start = chrono::high_resolution_clock::now();
+    TraceScope interiorScope("compute");
+    openMPMultiPassLowPassFilter(localWindow, windowOrigin, inputImage.size(), interiorOutput, kernel, passes, Rect(0, firstRow + interiorBegin, localWidth, interiorEnd - interiorBegin), 1, borderType);
+    interiorScope.end();
+    filterSeconds += chrono::duration<double>(chrono::high_resolution_clock::now() - filter_start).count();
+
+    // Wait for the exchange, then filter the boundary rows with the received rows. Blocks at the top or bottom of the
+    // image receive nothing on that side, they fill those rows from their own rows for the border, or leave them
+    // zero for a constant border. The window is as wide as the image, so the engine handles the border columns.
+    TraceScope haloScope("halo exchange");
+    MPI_Waitall(requestCount, requests, MPI_STATUSES_IGNORE);
+    haloScope.end();
+    if (localHeight > 0) {
+        TraceScope padScope("pad");
+        fillWindowBorder(localWindow, windowOrigin, inputImage.size(), borderType);
     }
 
-    // Initialize the output image on the root process
-    Mat outputImage;
+    filter_start = chrono::high_resolution_clock::now();
+    TraceScope boundaryScope("compute");
+    Mat topOutput = localOutputImage.rowRange(0, interiorBegin);
+    openMPMultiPassLowPassFilter(localWindow, windowOrigin, inputImage.size(), topOutput, kernel, passes, Rect(0, firstRow, localWidth, interiorBegin), 1, borderType);
+    Mat bottomOutput = localOutputImage.rowRange(interiorEnd, localHeight);
+    openMPMultiPassLowPassFilter(localWindow, windowOrigin, inputImage.size(), bottomOutput, kernel, passes, Rect(0, firstRow + interiorEnd, localWidth, localHeight - interiorEnd), 1, borderType);
+    boundaryScope.end();
+    filterSeconds += chrono::duration<double>(chrono::high_resolution_clock::now() - filter_start).count();
+
+    // Gather the filtered blocks from all processes into the root's output image, through a temporary one if it is not continuous
+    TraceScope gatherScope("gather");
+    Mat receiveImage;
     if (world_rank == collector) {
-        outputImage = Mat::zeros(paddedImage.size(), paddedImage.type());
+        CV_Assert(outputImage.size() == inputImage.size() && outputImage.type() == inputImage.type());
+        receiveImage = outputImage.isContinuous() ? outputImage : Mat(outputImage.size(), outputImage.type());
     }
-
-    // Gather the filtered blocks from all processes to the root process
-    MPI_Gatherv(localOutputImage.data, localHeight * localWidth, MPI_UNSIGNED_CHAR, outputImage.data, sendcounts, displs, MPI_UNSIGNED_CHAR, collector, MPI_COMM_WORLD);
+    MPI_Gatherv(localOutputImage.data, localHeight * rowSize, MPI_BYTE, receiveImage.data, sendcounts, displs, MPI_BYTE, collector, comm);
+    if (world_rank == collector && receiveImage.data != outputImage.data) {
+        receiveImage.copyTo(outputImage);
+    }
+    gatherScope.end();
 
     // Free the memory
     delete[] sendcounts;
     delete[] displs;
 
-    // Crop the output image to remove the padding and return it
+    if (timing != nullptr) {
+        timing->rows = localHeight;
+        timing->filterSeconds = filterSeconds;
+        timing->totalSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start_time).count();
+    }
+}
+
+void MPIMultiPassLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const MPI_Comm comm, const int borderType) {
+    // The same number of rows for every process
+    vector<int> rowCounts = MPIRowCounts(inputImage.rows, world_size, passes * (kernel.size() / 2));
+    filterRowBlocks(inputImage, outputImage, kernel, passes, rowCounts, world_size, world_rank, collector, comm, borderType, nullptr);
+}
+
+void MPILowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const MPI_Comm comm, const int borderType) {
+    MPIMultiPassLowPassFilter(inputImage, outputImage, kernel, 1, world_size, world_rank, collector, comm, borderType);
+}
+
+void MPILowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm) {
+    MPILowPassFilter(inputImage, outputImage, FilterKernel::box(kernelSize), world_size, world_rank, collector, comm);
+}
+
+Mat MPILowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const MPI_Comm comm, const int borderType) {
+    // Initialize the output image on the root process
+    Mat outputImage;
     if (world_rank == collector) {
-        Rect cropRegion(paddingSize, paddingSize, inputImage.cols, inputImage.rows);
-        return outputImage(cropRegion);
+        outputImage = Mat(inputImage.size(), inputImage.type());
     }
-    else {
-        return Mat();
+
+    MPILowPassFilter(inputImage, outputImage, kernel, world_size, world_rank, collector, comm, borderType);
+
+    return outputImage;
+}
+
+Mat MPILowPassFilter(const Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm) {
+    return MPILowPassFilter(inputImage, FilterKernel::box(kernelSize), world_size, world_rank, collector, comm);
+}
+
+Mat MPIMultiPassLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const MPI_Comm comm, const int borderType) {
+    // Initialize the output image on the root process
+    Mat outputImage;
+    if (world_rank == collector) {
+        outputImage = Mat(inputImage.size(), inputImage.type());
     }
+
+    MPIMultiPassLowPassFilter(inputImage, outputImage, kernel, passes, world_size, world_rank, collector, comm, borderType);
+
+    return outputImage;
 }
 
-namespace mpi
-{
-    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const bool waitFlag) {
-        // Start the timer
-        auto start_time = chrono::high_resolution_clock::now();
+BalancedMPILowPassFilter::BalancedMPILowPassFilter(const int world_size, const int world_rank, const int collector, const MPI_Comm comm)
+    : worldSize(world_size), worldRank(world_rank), collectorRank(collector), communicator(comm), rankWeights(world_size, 1.0), rankTimings(world_size) {
+}
+
+void BalancedMPILowPassFilter::filter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int borderType) {
+    vector<int> rowCounts = MPIRowCounts(inputImage.rows, worldSize, passes * (kernel.size() / 2), rankWeights);
+    MPIRankTiming timing;
+    filterRowBlocks(inputImage, outputImage, kernel, passes, rowCounts, worldSize, worldRank, collectorRank, communicator, borderType, &timing);
+
+    // Every process gets the timings of all of them, so they all derive the same weights and row counts
+    double localTiming[3] = { (double)timing.rows, timing.filterSeconds, timing.totalSeconds };
+    vector<double> allTimings(3 * worldSize);
+    MPI_Allgather(localTiming, 3, MPI_DOUBLE, allTimings.data(), 3, MPI_DOUBLE, communicator);
+
+    // The speed of a process is the rows it filters per second. Processes without rows keep their weight.
+    double speedSum = 0;
+    int measured = 0;
+    vector<double> speeds(worldSize, 0);
+    for (int i = 0; i < worldSize; i++) {
+        rankTimings[i].rows = (int)allTimings[3 * i];
+        rankTimings[i].filterSeconds = allTimings[3 * i + 1];
+        rankTimings[i].totalSeconds = allTimings[3 * i + 2];
+        if (rankTimings[i].rows > 0 && rankTimings[i].filterSeconds > 0) {
+            speeds[i] = rankTimings[i].rows / rankTimings[i].filterSeconds;
+            speedSum += speeds[i];
+            measured++;
+        }
+    }
+
+    // Move halfway towards the measured speeds, relative to their mean, so one noisy image does not swing the split
+    for (int i = 0; i < worldSize && measured > 0; i++) {
+        if (speeds[i] > 0) {
+            rankWeights[i] = 0.5 * rankWeights[i] + 0.5 * speeds[i] * measured / speedSum;
+        }
+    }
+}
+
+void BalancedMPILowPassFilter::calibrate(const Size& imageSize, const int type, const FilterKernel& kernel, const int passes, const int runs) {
+    // Only the collector's pixels are read, the other processes only need the size
+    Mat image(imageSize, type, Scalar::all(0));
+    Mat outputImage;
+    if (worldRank == collectorRank) {
+        randu(image, Scalar::all(0), Scalar::all(CV_MAT_DEPTH(type) == CV_8U ? 256 : CV_MAT_DEPTH(type) == CV_16U ? 65536 : 1));
+        outputImage = Mat(imageSize, type);
+    }
+    for (int i = 0; i < runs; i++) {
+        filter(image, outputImage, kernel, passes);
+    }
+}
 
-        // Perform convolution on the input image using the filter kernel
-        Mat outputImage = MPILowPassFilter(image, kernal_size, world_size, world_rank, collector);
+void BalancedMPILowPassFilter::setWeights(const vector<double>& weights) {
+    CV_Assert((int)weights.size() == worldSize);
+    rankWeights = weights;
+}
 
-        if (world_rank == collector) {
-            // Print the elapsed time in milliseconds
-            auto end_time = chrono::high_resolution_clock::now();
-            auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-            printf("MPI Elapsed time: %lld milliseconds\n", elapsed_time.count());
-            fflush(stdout);
+double BalancedMPILowPassFilter::imbalance() const {
+    double longest = 0, sum = 0;
+    int active = 0;
+    for (const MPIRankTiming& timing : rankTimings) {
+        if (timing.rows > 0) {
+            longest = max(longest, timing.filterSeconds);
+            sum += timing.filterSeconds;
+            active++;
+        }
+    }
+    return sum > 0 ? longest * active / sum : 1;
+}
 
-            // Display the input and output images
-            imshow("Original image", image);
-            imshow("MPI Output image", outputImage);
-            imwrite("mpiImage.png", outputImage);
+void BalancedMPILowPassFilter::printTimings() const {
+    if (worldRank != collectorRank) {
+        return;
+    }
+    for (int i = 0; i < worldSize; i++) {
+        const MPIRankTiming& timing = rankTimings[i];
+        printf("Rank %d: %d rows, filter %.3f ms, total %.3f ms, weight %.3f\n", i, timing.rows, timing.filterSeconds * 1000, timing.totalSeconds * 1000, rankWeights[i]);
+    }
+    printf("Imbalance (longest / mean filter time): %.3f\n", imbalance());
+    fflush(stdout);
+}
+
+bool writeTrace(const String& path, const int world_size, const int world_rank, const int collector, const MPI_Comm comm) {
+    // Times start from the first event of any process
+    double originMicroseconds = traceStartMicroseconds();
+    MPI_Allreduce(MPI_IN_PLACE, &originMicroseconds, 1, MPI_DOUBLE, MPI_MIN, comm);
 
-            // Wait for the user to press any key
-            if (waitFlag) {
-                waitKey(0);
-            }
+    // Every process writes its own events, then the collector gathers the text
+    const String localEvents = traceEvents(world_rank, originMicroseconds);
+    int localLength = (int)localEvents.size();
+    vector<int> lengths(world_size), displs(world_size);
+    MPI_Gather(&localLength, 1, MPI_INT, lengths.data(), 1, MPI_INT, collector, comm);
+    vector<char> allEvents;
+    if (world_rank == collector) {
+        for (int i = 0; i < world_size; i++) {
+            displs[i] = i > 0 ? displs[i - 1] + lengths[i - 1] : 0;
         }
+        allEvents.resize(displs[world_size - 1] + lengths[world_size - 1] + 1);
+    }
+    MPI_Gatherv(localEvents.c_str(), localLength, MPI_CHAR, allEvents.data(), lengths.data(), displs.data(), MPI_CHAR, collector, comm);
+    if (world_rank != collector) {
+        return true;
+    }
 
-        // Return the output image
-        return outputImage;
+    vector<String> processEvents;
+    for (int i = 0; i < world_size; i++) {
+        processEvents.push_back(String(allEvents.data() + displs[i], lengths[i]));
+    }
+    return writeTraceFile(path, processEvents);
+}
+
+bool MPIFileLowPassFilter(const String& inputPath, const String& outputPath, const ImageFileHeader& inputHeader, const int kernelSize, const int world_size, const int world_rank, const MPI_Comm comm) {
+    int paddingSize = kernelSize / 2;
+
+    // Every process reads its own rows plus the halo straight from the file, so there is no exchange and any
+    // block height works
+    int localHeight = inputHeader.rows / world_size;
+    int leftOver = inputHeader.rows % world_size;
+    int firstRow = world_rank * localHeight + min(world_rank, leftOver);
+    if (world_rank < leftOver) {
+        localHeight += 1;
+    }
+
+    // Read and write whole rows so the counts stay small for very large images
+    MPI_Datatype rowType;
+    MPI_Type_contiguous((int)(inputHeader.cols * CV_ELEM_SIZE(inputHeader.type)), MPI_BYTE, &rowType);
+    MPI_Type_commit(&rowType);
+    MPI_Offset rowBytes = (MPI_Offset)inputHeader.cols * CV_ELEM_SIZE(inputHeader.type);
+
+    // The output file has the same format and size, every process can work out where its pixels start
+    ImageFileHeader outputHeader = inputHeader;
+    ostringstream headerText;
+    writeImageHeader(headerText, outputHeader);
+
+    MPI_File inputFile, outputFile;
+    if (MPI_File_open(comm, inputPath.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &inputFile) != MPI_SUCCESS) {
+        MPI_Type_free(&rowType);
+        return false;
+    }
+    if (MPI_File_open(comm, outputPath.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &outputFile) != MPI_SUCCESS) {
+        MPI_File_close(&inputFile);
+        MPI_Type_free(&rowType);
+        return false;
     }
 
-    Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector) {
-        // Perform convolution on the input image
-        return process(image, kernal_size, world_size, world_rank, collector, true);
+    // Drop whatever an older, larger file had past the end of the image
+    MPI_File_set_size(outputFile, (MPI_Offset)outputHeader.dataOffset + inputHeader.rows * rowBytes);
+
+    // Rows above the first and below the last image row stay zero as padding
+    int windowFirstRow = max(firstRow - paddingSize, 0);
+    int windowLastRow = min(firstRow + localHeight + paddingSize, inputHeader.rows);
+    Mat localWindow = Mat::zeros(localHeight + 2 * paddingSize, inputHeader.cols, inputHeader.type);
+    Mat readRows = localWindow.rowRange(windowFirstRow - (firstRow - paddingSize), windowLastRow - (firstRow - paddingSize));
+    TraceScope readScope("read");
+    MPI_File_read_at_all(inputFile, (MPI_Offset)inputHeader.dataOffset + windowFirstRow * rowBytes, readRows.data, readRows.rows, rowType, MPI_STATUS_IGNORE);
+    MPI_File_close(&inputFile);
+    readScope.end();
+
+    // Perform convolution on the local rows using the running sum engine
+    Mat localOutputImage(localHeight, inputHeader.cols, inputHeader.type);
+    TraceScope computeScope("compute");
+    boxLowPassFilter(localWindow, localOutputImage, kernelSize, Rect(0, paddingSize, inputHeader.cols, localHeight));
+
+    computeScope.end();
+
+    // The first process writes the header, then all processes write their rows together
+    TraceScope writeScope("write");
+    if (world_rank == 0 && !headerText.str().empty()) {
+        MPI_File_write_at(outputFile, 0, headerText.str().data(), (int)headerText.str().size(), MPI_CHAR, MPI_STATUS_IGNORE);
     }
-}
\ No newline at end of file
+    MPI_File_write_at_all(outputFile, (MPI_Offset)outputHeader.dataOffset + firstRow * rowBytes, localOutputImage.data, localHeight, rowType, MPI_STATUS_IGNORE);
+    MPI_File_close(&outputFile);
+
+    MPI_Type_free(&rowType);
+    return true;
+}
+
+bool MPIFileLowPassFilter(const String& inputPath, const String& outputPath, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm) {
+    // Only the collector parses the header, the others get the size and the pixel offset from it
+    long long headerValues[5] = { 0, 0, 0, 0, 0 };
+    if (world_rank == collector) {
+        ifstream file(inputPath, ios::binary);
+        ImageFileHeader header;
+        if (file && readImageHeader(file, header)) {
+            headerValues[0] = header.format;
+            headerValues[1] = header.rows;
+            headerValues[2] = header.cols;
+            headerValues[3] = header.type;
+            headerValues[4] = header.dataOffset;
+        }
+    }
+    MPI_Bcast(headerValues, 5, MPI_LONG_LONG, collector, comm);
+    if (headerValues[1] == 0) {
+        return false;
+    }
+
+    ImageFileHeader inputHeader;
+    inputHeader.format = (ImageFileFormat)headerValues[0];
+    inputHeader.rows = (int)headerValues[1];
+    inputHeader.cols = (int)headerValues[2];
+    inputHeader.type = (int)headerValues[3];
+    inputHeader.dataOffset = (streamoff)headerValues[4];
+    return MPIFileLowPassFilter(inputPath, outputPath, inputHeader, kernelSize, world_size, world_rank, comm);
+}
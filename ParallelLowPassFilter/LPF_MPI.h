@@ -2,20 +2,87 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sstream>
 #include <opencv2/opencv.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgcodecs/imgcodecs.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/core/utils/logger.hpp>
 #include <mpi.h>
 
-using namespace cv;
-using namespace std;
+#include "LPF_OpenMP.h"
+#include "LPF_ImageIO.h"
 
-Mat MPILowPassFilter(const Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector);
+// Filter into an output image the caller owns on the root process, for example a mapped file. world_size,
+// world_rank and collector are the size of comm, the rank in it and the root's rank in it. The kernelSize
+// versions filter with the box kernel and a zero border. With BORDER_WRAP the first and last blocks exchange
+// their rows like neighbours, the other borders are filled in by the first and last blocks themselves.
+void MPILowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+void MPILowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD);
+cv::Mat MPILowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat MPILowPassFilter(const cv::Mat& inputImage, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD);
 
-namespace mpi
+// Filter with passes passes of the kernel after a single scatter. Every process exchanges a halo of passes *
+// kernel.size() / 2 rows with its neighbours once and filters all passes of its rows itself, before one gather.
+void MPIMultiPassLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat MPIMultiPassLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD, const int borderType = cv::BORDER_CONSTANT);
+
+// Rows of every process of a communicator of world_size processes for an image of rows rows, with a halo of
+// paddingSize rows. Every block gets at least paddingSize rows, so small images use only the first processes and
+// the others get none. Without weights the blocks differ by at most one row, with a positive weight per process
+// the rows are shared in proportion to them.
+std::vector<int> MPIRowCounts(const int rows, const int world_size, const int paddingSize, const std::vector<double>& weights = std::vector<double>());
+
+// How long a process worked on its rows of an image
+struct MPIRankTiming
+{
+	int rows = 0;
+	double filterSeconds = 0;          // Filtering its rows, without the scatter, the halo exchange and the gather
+	double totalSeconds = 0;           // The whole call, including waiting for the other processes
+};
+
+// Filters a series of images, such as the frames of a video, on processes of different speed. Every image is split
+// into row blocks in proportion to a weight per process. Every call times how long every process filtered its rows,
+// and the next call moves rows from the slow processes to the fast ones, so the slowest node no longer sets the
+// time of every image. All processes of comm call every method, like MPILowPassFilter.
+class BalancedMPILowPassFilter
 {
-	Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector, const bool waitFlag);
-	Mat process(const Mat& image, const int kernal_size, const int world_size, const int world_rank, const int collector);
-}
\ No newline at end of file
+public:
+	BalancedMPILowPassFilter(const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD);
+
+	// Filter like MPIMultiPassLowPassFilter with the current weights, then update the weights from the timings
+	void filter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes = 1, const int borderType = cv::BORDER_CONSTANT);
+
+	// Filter a random image of the given size a few times to find the weights before the first real image
+	void calibrate(const cv::Size& imageSize, const int type, const FilterKernel& kernel, const int passes = 1, const int runs = 3);
+
+	// Relative speeds, equal at first. Weights known in advance, such as from an earlier run, can be set directly.
+	const std::vector<double>& weights() const { return rankWeights; }
+	void setWeights(const std::vector<double>& weights);
+
+	// Timings of every process for the last image, the same on every process
+	const std::vector<MPIRankTiming>& timings() const { return rankTimings; }
+
+	// The longest filter time of the last image over the mean one, 1 when the processes are balanced
+	double imbalance() const;
+
+	// Print the timings of every process on the collector
+	void printTimings() const;
+
+private:
+	int worldSize;
+	int worldRank;
+	int collectorRank;
+	MPI_Comm communicator;
+	std::vector<double> rankWeights;
+	std::vector<MPIRankTiming> rankTimings;
+};
+
+// Write the events of every process of comm to path as a Chrome trace, with one process per rank. All processes of
+// comm call it, only the collector writes the file. Times are in microseconds from the first event of any process,
+// taken from the wall clock, so processes on different nodes line up as well as their clocks do.
+bool writeTrace(const cv::String& path, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD);
+
+// Filter an image file without any process holding the whole image. Every process reads its rows plus the
+// kernelSize / 2 rows around them with MPI-IO and writes its output rows with a collective write. The output
+// file gets the format of the input, raw files need the header filled in by the caller. All processes of comm open
+// the files together, world_size and world_rank are its size and the rank in it.
+bool MPIFileLowPassFilter(const cv::String& inputPath, const cv::String& outputPath, const ImageFileHeader& inputHeader, const int kernelSize, const int world_size, const int world_rank, const MPI_Comm comm = MPI_COMM_WORLD);
+bool MPIFileLowPassFilter(const cv::String& inputPath, const cv::String& outputPath, const int kernelSize, const int world_size, const int world_rank, const int collector, const MPI_Comm comm = MPI_COMM_WORLD);
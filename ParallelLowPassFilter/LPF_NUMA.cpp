@@ -0,0 +1,221 @@
+#include "LPF_NUMA.h"
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// CPU lists of sysfs, like 0-3,8-11
+static vector<int> parseCpuList(const string& text) {
+    vector<int> cpus;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == string::npos) {
+            end = text.size();
+        }
+        const string item = text.substr(begin, end - begin);
+        const size_t dash = item.find('-');
+        const int first = atoi(item.c_str());
+        const int last = dash == string::npos ? first : atoi(item.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last && !item.empty(); cpu++) {
+            cpus.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+    return cpus;
+}
+
+// The CPUs of every node the process may run on, read once
+static const vector<vector<int>>& numaNodes() {
+    static const vector<vector<int>> nodes = []() {
+        vector<vector<int>> result;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool limited = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        ifstream online("/sys/devices/system/node/online");
+        string nodeList;
+        if (online && getline(online, nodeList)) {
+            for (int node : parseCpuList(nodeList)) {
+                ifstream cpuFile("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+                string cpuList;
+                vector<int> cpus;
+                if (cpuFile && getline(cpuFile, cpuList)) {
+                    for (int cpu : parseCpuList(cpuList)) {
+                        if (!limited || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                            cpus.push_back(cpu);
+                        }
+                    }
+                }
+                if (!cpus.empty()) {
+                    result.push_back(cpus);
+                }
+            }
+        }
+#elif defined(_WIN32)
+        // The first 64 CPUs, the ones of the processor group the process starts in
+        DWORD_PTR processMask = 0, systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode)) {
+            for (ULONG node = 0; node <= highestNode; node++) {
+                ULONGLONG nodeMask = 0;
+                vector<int> cpus;
+                if (GetNumaNodeProcessorMask((UCHAR)node, &nodeMask)) {
+                    for (int cpu = 0; cpu < 64; cpu++) {
+                        if ((nodeMask & processMask) & (1ULL << cpu)) {
+                            cpus.push_back(cpu);
+                        }
+                    }
+                }
+                if (!cpus.empty()) {
+                    result.push_back(cpus);
+                }
+            }
+        }
+#endif
+        return result;
+    }();
+    return nodes;
+}
+
+int numaNodeCount() {
+    return max((int)numaNodes().size(), 1);
+}
+
+vector<int> numaThreadCpus(const int num_of_threads, const int nodes) {
+    vector<int> cpus(max(num_of_threads, 0), -1);
+    const vector<vector<int>>& nodeCpus = numaNodes();
+    if (nodeCpus.empty()) {
+        return cpus;
+    }
+
+    // Consecutive threads share a node, so the bands of a node are next to each other
+    const int usedNodes = nodes > 0 ? min(nodes, (int)nodeCpus.size()) : (int)nodeCpus.size();
+    for (int thread = 0; thread < num_of_threads; thread++) {
+        const int node = (int)((long long)thread * usedNodes / num_of_threads);
+        const int firstThread = (int)(((long long)node * num_of_threads + usedNodes - 1) / usedNodes);
+        cpus[thread] = nodeCpus[node][(thread - firstThread) % nodeCpus[node].size()];
+    }
+    return cpus;
+}
+
+vector<Rect> numaBands(const Rect& region, const int num_of_threads) {
+    vector<Rect> bands;
+    const int bandCount = min(max(num_of_threads, 1), max(region.height, 1));
+    for (int band = 0; band < bandCount && !region.empty(); band++) {
+        const int top = region.y + (int)((long long)region.height * band / bandCount);
+        const int bottom = region.y + (int)((long long)region.height * (band + 1) / bandCount);
+        bands.push_back(Rect(region.x, top, region.width, bottom - top));
+    }
+    return bands;
+}
+
+// Pins the calling thread to a CPU for its lifetime and gives it back the CPUs it could run on before, so the
+// OpenMP threads of the other filters stay free to move
+class ThreadPin
+{
+public:
+    explicit ThreadPin(const int cpu) {
+        if (cpu < 0) {
+            return;
+        }
+#if defined(__linux__)
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu, &mask);
+        pinned = sched_getaffinity(0, sizeof(previous), &previous) == 0 && sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#elif defined(_WIN32)
+        previous = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+        pinned = previous != 0;
+#endif
+    }
+
+    ~ThreadPin() {
+        if (!pinned) {
+            return;
+        }
+#if defined(__linux__)
+        sched_setaffinity(0, sizeof(previous), &previous);
+#elif defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), previous);
+#endif
+    }
+
+    ThreadPin(const ThreadPin&) = delete;
+    ThreadPin& operator=(const ThreadPin&) = delete;
+
+private:
+    bool pinned = false;
+#if defined(__linux__)
+    cpu_set_t previous;
+#elif defined(_WIN32)
+    DWORD_PTR previous = 0;
+#endif
+};
+
+// Run work(band) for every band on the pinned thread that owns it. A team smaller than asked for takes the bands of
+// the missing threads in turn.
+template <typename Work>
+static void forEachBand(const vector<Rect>& bands, const int num_of_threads, const int nodes, const Work& work) {
+    const vector<int> cpus = numaThreadCpus(num_of_threads, nodes);
+
+#pragma omp parallel num_threads(num_of_threads)
+    {
+        const int thread = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+        ThreadPin pin(cpus[thread]);
+        for (int band = thread; band < (int)bands.size(); band += team) {
+            work(bands[band]);
+        }
+    }
+}
+
+Mat numaImage(const Size& size, const int type, const int num_of_threads, const int nodes) {
+    // Large allocations are mapped without being touched, their pages are placed by the first write
+    Mat image(size, type);
+    forEachBand(numaBands(Rect(Point(0, 0), size), num_of_threads), num_of_threads, nodes, [&](const Rect& band) {
+        image(band).setTo(Scalar::all(0));
+    });
+    return image;
+}
+
+Mat numaCopy(const Mat& image, const int num_of_threads, const int nodes) {
+    Mat copy(image.size(), image.type());
+    forEachBand(numaBands(Rect(0, 0, image.cols, image.rows), num_of_threads), num_of_threads, nodes, [&](const Rect& band) {
+        Mat copyBand = copy(band);
+        image(band).copyTo(copyBand);
+    });
+    return copy;
+}
+
+void numaLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int nodes, const int borderType) {
+    CV_Assert(passes > 0 && num_of_threads > 0 && outputImage.size() == inputImage.size() && outputImage.type() == inputImage.type());
+
+    // The bands are cut into tiles like the OpenMP filter's, walked in order by their owner
+    forEachBand(numaBands(Rect(0, 0, inputImage.cols, inputImage.rows), num_of_threads), num_of_threads, nodes, [&](const Rect& band) {
+        for (const Rect& tile : makeTiles(band, kernel.size(), 1, inputImage.type(), passes)) {
+            TraceScope scope("tile");
+            Mat outputTile = outputImage(tile);
+            passLowPassFilter(inputImage, Point(0, 0), inputImage.size(), outputTile, tile, kernel, passes, borderType, threadScratch());
+        }
+    });
+}
+
+Mat numaLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int nodes, const int borderType) {
+    Mat outputImage = numaImage(inputImage.size(), inputImage.type(), num_of_threads, nodes);
+
+    numaLowPassFilter(inputImage, outputImage, kernel, passes, num_of_threads, nodes, borderType);
+
+    return outputImage;
+}
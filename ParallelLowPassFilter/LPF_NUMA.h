@@ -0,0 +1,38 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "LPF_OpenMP.h"
+
+// A shared-memory filter for machines with several NUMA nodes, such as dual-socket hosts. The OpenMP filter hands
+// out its tiles dynamically, so the pages of an image end up on whichever node touched them first and most threads
+// read across the interconnect. Here every thread owns a fixed band of rows, is pinned to a CPU of its node while it
+// filters, and the images are first written by the owner of every band, so their pages sit on the node that reads
+// and writes them. Threads are spread over the nodes in order: the first bands on the first node, and so on.
+//
+// The topology comes from /sys/devices/system/node on Linux and from the NUMA functions of Windows, limited to the
+// CPUs the process may run on. Without it the machine is one node and threads are not pinned.
+
+// The number of NUMA nodes with CPUs the process may run on, 1 when unknown
+int numaNodeCount();
+
+// The CPU every thread is pinned to, -1 for none: threads spread evenly over the first nodes nodes, or all of them
+// when nodes is 0 or more than there are, and over the CPUs within a node
+std::vector<int> numaThreadCpus(const int num_of_threads, const int nodes = 0);
+
+// The band of rows of the region every thread owns, as even as possible
+std::vector<cv::Rect> numaBands(const cv::Rect& region, const int num_of_threads);
+
+// An image whose bands are first written, with zeros or with a copy of image, by the pinned thread that owns them,
+// for numaLowPassFilter with the same number of threads and nodes
+cv::Mat numaImage(const cv::Size& size, const int type, const int num_of_threads, const int nodes = 0);
+cv::Mat numaCopy(const cv::Mat& image, const int num_of_threads, const int nodes = 0);
+
+// Filter with passes passes of the kernel like openMPMultiPassLowPassFilter, every pinned thread filtering the tiles
+// of its own band. Images from numaImage and numaCopy keep all reads and writes of a thread on its node, except for
+// the kernelSize / 2 halo rows at the edges of the bands.
+void numaLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int nodes = 0, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat numaLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int nodes = 0, const int borderType = cv::BORDER_CONSTANT);
@@ -1,71 +1,150 @@
 #include "LPF_OpenMP.h"
 
-Mat openMPLowPassFilter(const Mat& inputImage, const int kernelSize, const int num_of_threads) {
-    // Define the filter kernel
-    float filter_value = (1 / (float)(kernelSize * kernelSize));
-
-    // Perform zero padding on the input image
-    int paddingSize = kernelSize / 2;
-    Mat paddedImage;
-    copyMakeBorder(inputImage, paddedImage, paddingSize, paddingSize, paddingSize, paddingSize, BORDER_CONSTANT, Scalar(0));
-
-    // Create an output image with the same size as the input image
-    Mat outputImage(inputImage.size(), inputImage.type());
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
-    //// Print the number of threads
-    //printf("Number of threads: %d\n", num_of_threads);
+using namespace cv;
+using namespace std;
 
-    // Perform convolution on the padded image using the filter kernel
-#pragma omp parallel for collapse(2) num_threads(num_of_threads)
-    for (int i = paddingSize; i < paddedImage.rows - paddingSize; i++) {
-        for (int j = paddingSize; j < paddedImage.cols - paddingSize; j++) {
-            float sum = 0.0;
-            for (int k = -paddingSize; k <= paddingSize; k++) {
-                for (int l = -paddingSize; l <= paddingSize; l++) {
-                    float pixelValue = paddedImage.at<uchar>(i + k, j + l);
-                    sum += pixelValue * filter_value;
+size_t l2CacheSize() {
+    static const size_t cacheSize = []() {
+        size_t size = 0;
+#if defined(_WIN32)
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+            for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : info) {
+                if (entry.Relationship == RelationCache && entry.Cache.Level == 2) {
+                    size = entry.Cache.Size;
+                    break;
                 }
             }
-            outputImage.at<uchar>(i - paddingSize, j - paddingSize) = sum;
         }
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+        long result = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (result > 0) {
+            size = (size_t)result;
+        }
+#endif
+        // Assume a common 256 KiB L2 when the OS does not tell
+        return size > 0 ? size : (size_t)256 * 1024;
+    }();
+    return cacheSize;
+}
+
+vector<Rect> makeTiles(const Rect& region, const int kernelSize, const int num_of_threads, const int type, const int passes) {
+    vector<Rect> tiles;
+    if (region.empty()) {
+        return tiles;
+    }
+
+    // While a tile is filtered the engine keeps kernelSize + 1 input rows, the column and prefix sums (4 bytes
+    // per 8-bit channel, 8 bytes per wider one) and the output row in flight. Use half of L2 for that and leave
+    // the rest to the other data.
+    const int paddingSize = kernelSize / 2;
+    const size_t budget = l2CacheSize() / 2;
+    const int pixelSize = (int)CV_ELEM_SIZE(type);
+    int tileWidth, maxTileHeight;
+    if (passes > 1) {
+        // Fused passes keep the window of a tile, the tile plus passes * paddingSize pixels on every side, in two
+        // buffers from the first pass to the last. Square tiles keep the halo smallest. Tiles much smaller than the
+        // halo would spend their time filtering the overlap with their neighbours, so they stay at least that big.
+        const int halo = passes * paddingSize;
+        const int windowSide = (int)sqrt((double)budget / (2 * pixelSize));
+        const int side = max(windowSide - 2 * halo, max(2 * halo, 64));
+        tileWidth = min(side, region.width);
+        maxTileHeight = side;
+    }
+    else {
+        const int sumSize = (CV_MAT_DEPTH(type) == CV_8U ? 4 : 8) * CV_MAT_CN(type);
+        const int bytesPerColumn = (kernelSize + 2) * pixelSize + 2 * sumSize;
+        tileWidth = (int)(budget / bytesPerColumn) - 2 * paddingSize;
+        tileWidth = min(max(tileWidth, 64), region.width);
+
+        // Tall tiles amortize priming the column sums with kernelSize rows
+        maxTileHeight = max(4 * kernelSize, 256);
+    }
+
+    // Keep a few tiles per thread so the dynamic schedule can balance them
+    const int tileColumns = (region.width + tileWidth - 1) / tileWidth;
+    const int wantedTiles = 4 * max(num_of_threads, 1);
+    const int wantedRows = (wantedTiles + tileColumns - 1) / tileColumns;
+    int tileHeight = min(maxTileHeight, (region.height + wantedRows - 1) / wantedRows);
+    tileHeight = min(max(tileHeight, 16), region.height);
+
+    for (int y = region.y; y < region.y + region.height; y += tileHeight) {
+        for (int x = region.x; x < region.x + region.width; x += tileWidth) {
+            tiles.push_back(Rect(x, y, min(tileWidth, region.x + region.width - x), min(tileHeight, region.y + region.height - y)));
+        }
+    }
+    return tiles;
+}
+
+void openMPMultiPassLowPassFilter(const Mat& source, const Point& sourceOrigin, const Size& imageSize, Mat& outputImage, const FilterKernel& kernel, const int passes, const Rect& target, const int num_of_threads, const int borderType, FilterScratch* scratches) {
+    CV_Assert(passes > 0 && outputImage.size() == target.size());
+
+    // Every tile reads its halo straight from the source, the engine reads the part of the halo outside the image
+    // through the border, so no padded copy of the image is made. With several passes every tile goes through all
+    // of them before the next one starts.
+    vector<Rect> tiles = makeTiles(target, kernel.size(), num_of_threads, source.type(), passes);
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_of_threads)
+    for (int t = 0; t < (int)tiles.size(); t++) {
+        TraceScope scope("tile");
+        const Rect& tile = tiles[t];
+        Mat outputTile = outputImage(tile - target.tl());
+        FilterScratch& scratch = scratches != nullptr ? scratches[omp_get_thread_num()] : threadScratch();
+        passLowPassFilter(source, sourceOrigin, imageSize, outputTile, tile, kernel, passes, borderType, scratch);
     }
+}
+
+void openMPMultiPassLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int borderType) {
+    openMPMultiPassLowPassFilter(inputImage, Point(0, 0), inputImage.size(), outputImage, kernel, passes, Rect(0, 0, inputImage.cols, inputImage.rows), num_of_threads, borderType);
+}
+
+Mat openMPMultiPassLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int borderType) {
+    // Create an output image with the same size as the input image
+    Mat outputImage(inputImage.size(), inputImage.type());
+
+    openMPMultiPassLowPassFilter(inputImage, outputImage, kernel, passes, num_of_threads, borderType);
 
     return outputImage;
 }
 
-namespace openmp
-{
-    Mat process(const Mat& image, const int kernal_size, const int num_of_threads, const bool waitFlag) {
-        // Start the timer
-        auto start_time = chrono::high_resolution_clock::now();
+void openMPLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const Rect& region, const int num_of_threads, const int borderType) {
+    // A single pass of the multi-pass tiles is one engine call per tile
+    openMPMultiPassLowPassFilter(inputImage, Point(0, 0), inputImage.size(), outputImage, kernel, 1, region, num_of_threads, borderType);
+}
 
-        // Perform convolution on the input image using the filter kernel
-        Mat outputImage = openMPLowPassFilter(image, kernal_size, num_of_threads);
+void openMPLowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize, const Rect& region, const int num_of_threads) {
+    openMPLowPassFilter(inputImage, outputImage, FilterKernel::box(kernelSize), region, num_of_threads);
+}
 
-        // Stop the timer
-        auto end_time = chrono::high_resolution_clock::now();
+void openMPLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int num_of_threads, const int borderType) {
+    openMPLowPassFilter(inputImage, outputImage, kernel, Rect(0, 0, inputImage.cols, inputImage.rows), num_of_threads, borderType);
+}
 
-        // Print the elapsed time in milliseconds
-        auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-        printf("OpenMP Elapsed time: %lld milliseconds\n", elapsed_time.count());
-        fflush(stdout);
+void openMPLowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize, const int num_of_threads) {
+    openMPLowPassFilter(inputImage, outputImage, FilterKernel::box(kernelSize), num_of_threads);
+}
 
-        // Display the input and output images
-        imshow("Original image", image);
-        imshow("OpenMP Output image", outputImage);
-        imwrite("OpenMPImage.png", outputImage);
+Mat openMPLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int num_of_threads, const int borderType) {
+    // Create an output image with the same size as the input image
+    Mat outputImage(inputImage.size(), inputImage.type());
 
-        // Wait for the user to press any key
-        if (waitFlag) {
-            waitKey(0);
-        }
+    //// Print the number of threads
+    //printf("Number of threads: %d\n", num_of_threads);
 
-        // Return the output image
-        return outputImage;
-    }
+    openMPLowPassFilter(inputImage, outputImage, kernel, Rect(0, 0, inputImage.cols, inputImage.rows), num_of_threads, borderType);
 
-    Mat process(const Mat& image, const int kernal_size, const int num_of_threads) {
-        // Perform convolution on the input image
-        return process(image, kernal_size, num_of_threads, true);
-    }
-}
\ No newline at end of file
+    return outputImage;
+}
+
+Mat openMPLowPassFilter(const Mat& inputImage, const int kernelSize, const int num_of_threads) {
+    return openMPLowPassFilter(inputImage, FilterKernel::box(kernelSize), num_of_threads);
+}
@@ -2,21 +2,34 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
-#include <opencv2/opencv.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgcodecs/imgcodecs.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/core/utils/logger.hpp>
 
 #include <omp.h>
+#include <vector>
 
-using namespace cv;
-using namespace std;
+#include "LPF_Kernel.h"
+#include "LPF_Trace.h"
 
-Mat openMPLowPassFilter(const Mat& inputImage, int kernelSize, const int num_of_threads);
+// Size of the L2 cache of one core in bytes
+size_t l2CacheSize();
 
-namespace openmp
-{
-	Mat process(const Mat& image, const int kernal_size, const int num_of_threads, const bool waitFlag);
-	Mat process(const Mat& image, const int kernal_size, const int num_of_threads);
-}
\ No newline at end of file
+// Split a region of the output into 2D tiles that fit in L2 together with their kernelSize / 2 halo, for pixels of
+// the given type. With several passes the tiles fit in L2 with the windows of all passes.
+std::vector<cv::Rect> makeTiles(const cv::Rect& region, const int kernelSize, const int num_of_threads, const int type = CV_8UC1, const int passes = 1);
+
+// Filter the region of the input into outputImage (of the region's size), tiles are scheduled dynamically.
+// The kernelSize versions filter with the box kernel and a zero border.
+void openMPLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const cv::Rect& region, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT);
+void openMPLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize, const cv::Rect& region, const int num_of_threads);
+void openMPLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT);
+void openMPLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize, const int num_of_threads);
+cv::Mat openMPLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat openMPLowPassFilter(const cv::Mat& inputImage, int kernelSize, const int num_of_threads);
+
+// Filter with passes passes of the kernel, every tile through all passes while it is in cache. The first version
+// filters the target of an image of imageSize from a source window at sourceOrigin, as passLowPassFilter does,
+// with scratches, when given, holding one scratch per thread.
+void openMPMultiPassLowPassFilter(const cv::Mat& source, const cv::Point& sourceOrigin, const cv::Size& imageSize, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const cv::Rect& target, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT, FilterScratch* scratches = nullptr);
+void openMPMultiPassLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat openMPMultiPassLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int num_of_threads, const int borderType = cv::BORDER_CONSTANT);
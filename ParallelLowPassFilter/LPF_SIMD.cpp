@@ -0,0 +1,197 @@
+#include "LPF_SIMD.h"
+#include <atomic>
+
+#if defined(LPF_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace cv;
+using namespace std;
+
+// Scalar kernels, used as the fallback and as the reference for the vector ones
+
+static void scalarAddRow(unsigned int* columnSums, const uchar* row, const int count) {
+    for (int i = 0; i < count; i++) {
+        columnSums[i] += row[i];
+    }
+}
+
+static void scalarSubtractRow(unsigned int* columnSums, const uchar* row, const int count) {
+    for (int i = 0; i < count; i++) {
+        columnSums[i] -= row[i];
+    }
+}
+
+static void scalarSlideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) {
+    for (int i = 0; i < count; i++) {
+        columnSums[i] += addedRow[i] - removedRow[i];
+    }
+}
+
+static void scalarPrefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) {
+    unsigned int sum = 0;
+    prefixSums[0] = 0;
+    for (int i = 0; i < count; i++) {
+        sum += columnSums[i];
+        prefixSums[i + 1] = sum;
+    }
+}
+
+static void scalarAverageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) {
+    const BoxDivisor divisor = boxDivisor(kernelSize);
+    for (int j = 0; j < width; j++) {
+        outputRow[j] = boxDivide(prefixSums[j + kernelSize] - prefixSums[j], divisor);
+    }
+}
+
+const BoxRowKernels* scalarBoxRowKernels() {
+    static const BoxRowKernels kernels = { SIMD_SCALAR, scalarAddRow, scalarSubtractRow, scalarSlideRow, scalarPrefixSum, scalarAverageRow };
+    return &kernels;
+}
+
+BoxDivisor boxDivisor(const int kernelSize) {
+    const unsigned int area = kernelSize * kernelSize;
+
+    // With area <= 2^bits and dividends below 2^8 * area, shift = 8 + 2 * bits bounds the error term, and the
+    // multiplier stays below 2^(9 + bits), which fits in 32 bits for every kernel below 2048
+    int bits = 0;
+    while ((1u << bits) < area) {
+        bits++;
+    }
+
+    BoxDivisor divisor;
+    divisor.half = area / 2;
+    divisor.shift = 8 + 2 * bits;
+    divisor.multiplier = (unsigned int)(((1ull << divisor.shift) + area - 1) / area);
+    return divisor;
+}
+
+// Runtime detection of the instruction sets
+
+#if defined(LPF_X86)
+static void cpuid(int info[4], const int leaf, const int subleaf) {
+#if defined(_MSC_VER)
+    __cpuidex(info, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+// Register state the OS saves on a context switch, AVX and AVX-512 are unusable without it
+static unsigned long long xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+SIMDLevel detectSIMDLevel() {
+#if defined(LPF_X86)
+    int info[4];
+    cpuid(info, 0, 0);
+    const int maxLeaf = info[0];
+
+    cpuid(info, 1, 0);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    bool avx512 = false;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        const unsigned long long xcr0 = xgetbv();
+        cpuid(info, 7, 0);
+        avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        avx512 = (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+    }
+
+    if (avx512 && avx512BoxRowKernels()) {
+        return SIMD_AVX512;
+    }
+    if (avx2 && avx2BoxRowKernels()) {
+        return SIMD_AVX2;
+    }
+    if (sse2 && sse2BoxRowKernels()) {
+        return SIMD_SSE2;
+    }
+#elif defined(LPF_NEON)
+    if (neonBoxRowKernels()) {
+        return SIMD_NEON;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+static const BoxRowKernels* kernelsForLevel(const SIMDLevel level) {
+    switch (level) {
+    case SIMD_NEON:
+        return neonBoxRowKernels();
+    case SIMD_SSE2:
+        return sse2BoxRowKernels();
+    case SIMD_AVX2:
+        return avx2BoxRowKernels();
+    case SIMD_AVX512:
+        return avx512BoxRowKernels();
+    default:
+        return scalarBoxRowKernels();
+    }
+}
+
+vector<SIMDLevel> supportedSIMDLevels() {
+    const SIMDLevel detected = detectSIMDLevel();
+    vector<SIMDLevel> levels;
+    for (int level = SIMD_SCALAR; level <= detected; level++) {
+        if (kernelsForLevel((SIMDLevel)level)) {
+            levels.push_back((SIMDLevel)level);
+        }
+    }
+    return levels;
+}
+
+const char* simdLevelName(const SIMDLevel level) {
+    switch (level) {
+    case SIMD_NEON:
+        return "NEON";
+    case SIMD_SSE2:
+        return "SSE2";
+    case SIMD_AVX2:
+        return "AVX2";
+    case SIMD_AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
+
+static atomic<const BoxRowKernels*> selectedKernels(nullptr);
+
+SIMDLevel getSIMDLevel() {
+    return getBoxRowKernels().level;
+}
+
+void setSIMDLevel(const SIMDLevel level) {
+    // Fall back to the best level below the requested one that this CPU and build support
+    const SIMDLevel detected = detectSIMDLevel();
+    int chosen = min((int)level, (int)detected);
+    while (chosen > SIMD_SCALAR && kernelsForLevel((SIMDLevel)chosen) == nullptr) {
+        chosen--;
+    }
+    selectedKernels.store(kernelsForLevel((SIMDLevel)chosen));
+}
+
+const BoxRowKernels& getBoxRowKernels() {
+    const BoxRowKernels* kernels = selectedKernels.load();
+    if (kernels == nullptr) {
+        kernels = kernelsForLevel(detectSIMDLevel());
+        selectedKernels.store(kernels);
+    }
+    return *kernels;
+}
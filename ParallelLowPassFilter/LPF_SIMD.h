@@ -0,0 +1,82 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Compile the function for an instruction set without changing the flags of the whole project
+#if defined(__GNUC__) || defined(__clang__)
+#define LPF_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LPF_TARGET(isa)
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LPF_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define LPF_NEON 1
+#endif
+
+enum SIMDLevel
+{
+	SIMD_SCALAR = 0,
+	SIMD_NEON,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+// Row kernels used by the box filter engine. Every instruction set gives bit identical results.
+struct BoxRowKernels
+{
+	SIMDLevel level;
+
+	// Widen a row of pixels to 32 bits and add it to, remove it from, or slide it through the column sums
+	void (*addRow)(unsigned int* columnSums, const uchar* row, const int count);
+	void (*subtractRow)(unsigned int* columnSums, const uchar* row, const int count);
+	void (*slideRow)(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count);
+
+	// prefixSums[0] = 0 and prefixSums[i + 1] = columnSums[0] + ... + columnSums[i]
+	void (*prefixSum)(unsigned int* prefixSums, const unsigned int* columnSums, const int count);
+
+	// outputRow[j] = (prefixSums[j + kernelSize] - prefixSums[j]) / (kernelSize * kernelSize), rounded to nearest
+	void (*averageRow)(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize);
+};
+
+// Division of an 8-bit window sum by the kernel area, rounded to nearest, as one multiply and one shift:
+// ((sum + half) * multiplier) >> shift. The multiplier is 2^shift / area rounded up, and shift is chosen so
+// its rounding error times the largest dividend (below 256 * area) stays under 2^shift, which makes the
+// result exact for every sum. Dividends and multipliers fit in 32 bits and their product in 64.
+struct BoxDivisor
+{
+	unsigned int half;
+	unsigned int multiplier;
+	int shift;
+};
+
+BoxDivisor boxDivisor(const int kernelSize);
+
+inline uchar boxDivide(const unsigned int sum, const BoxDivisor& divisor) {
+	return (uchar)(((unsigned long long)(sum + divisor.half) * divisor.multiplier) >> divisor.shift);
+}
+
+// Kernel tables for each instruction set, null when the set is not compiled for this architecture
+const BoxRowKernels* scalarBoxRowKernels();
+const BoxRowKernels* neonBoxRowKernels();
+const BoxRowKernels* sse2BoxRowKernels();
+const BoxRowKernels* avx2BoxRowKernels();
+const BoxRowKernels* avx512BoxRowKernels();
+
+// Best instruction set supported by the CPU and the OS, read once from CPUID
+SIMDLevel detectSIMDLevel();
+std::vector<SIMDLevel> supportedSIMDLevels();
+const char* simdLevelName(const SIMDLevel level);
+
+// The level used by the engine defaults to the detected one. Setting it is meant for comparing the kernels,
+// a level above the detected one is lowered to the detected one.
+SIMDLevel getSIMDLevel();
+void setSIMDLevel(const SIMDLevel level);
+const BoxRowKernels& getBoxRowKernels();
@@ -0,0 +1,106 @@
+#include "LPF_SIMD.h"
+
+#if defined(LPF_X86)
+#include <immintrin.h>
+
+// Add 8 pixels to 8 column sums, widening uint8 -> uint32
+LPF_TARGET("avx2") static inline __m256i avx2Widen8(const uchar* row) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)row));
+}
+
+LPF_TARGET("avx2") static void avx2AddRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* sums = (__m256i*)(columnSums + i);
+        _mm256_storeu_si256(sums, _mm256_add_epi32(_mm256_loadu_si256(sums), avx2Widen8(row + i)));
+    }
+    for (; i < count; i++) {
+        columnSums[i] += row[i];
+    }
+}
+
+LPF_TARGET("avx2") static void avx2SubtractRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* sums = (__m256i*)(columnSums + i);
+        _mm256_storeu_si256(sums, _mm256_sub_epi32(_mm256_loadu_si256(sums), avx2Widen8(row + i)));
+    }
+    for (; i < count; i++) {
+        columnSums[i] -= row[i];
+    }
+}
+
+LPF_TARGET("avx2") static void avx2SlideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* sums = (__m256i*)(columnSums + i);
+        const __m256i difference = _mm256_sub_epi32(avx2Widen8(addedRow + i), avx2Widen8(removedRow + i));
+        _mm256_storeu_si256(sums, _mm256_add_epi32(_mm256_loadu_si256(sums), difference));
+    }
+    for (; i < count; i++) {
+        columnSums[i] += addedRow[i] - removedRow[i];
+    }
+}
+
+// Scan each 128-bit lane, move the low lane total into the high lane, then add the carry of the previous block
+LPF_TARGET("avx2") static void avx2PrefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) {
+    const __m256i lastLane = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    prefixSums[0] = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(columnSums + i));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+        const __m256i lowTotal = _mm256_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+        v = _mm256_add_epi32(v, _mm256_permute2x128_si256(lowTotal, lowTotal, 0x08));
+        v = _mm256_add_epi32(v, carry);
+        _mm256_storeu_si256((__m256i*)(prefixSums + i + 1), v);
+        carry = _mm256_permutevar8x32_epi32(v, lastLane);
+    }
+    unsigned int sum = (unsigned int)_mm256_cvtsi256_si32(carry);
+    for (; i < count; i++) {
+        sum += columnSums[i];
+        prefixSums[i + 1] = sum;
+    }
+}
+
+// Divide 8 window sums by the kernel area with the multiply-shift of boxDivide, even and odd lanes as in sse2Divide4
+LPF_TARGET("avx2") static inline __m256i avx2Divide8(const __m256i sums, const __m256i half, const __m256i multiplier, const __m128i shift) {
+    const __m256i dividends = _mm256_add_epi32(sums, half);
+    const __m256i even = _mm256_srl_epi64(_mm256_mul_epu32(dividends, multiplier), shift);
+    const __m256i odd = _mm256_srl_epi64(_mm256_mul_epu32(_mm256_srli_epi64(dividends, 32), multiplier), shift);
+    return _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+}
+
+LPF_TARGET("avx2") static void avx2AverageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) {
+    const BoxDivisor divisor = boxDivisor(kernelSize);
+    const __m256i half = _mm256_set1_epi32((int)divisor.half);
+    const __m256i multiplier = _mm256_set1_epi32((int)divisor.multiplier);
+    const __m128i shift = _mm_cvtsi32_si128(divisor.shift);
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m256i quotients[2];
+        for (int part = 0; part < 2; part++) {
+            const __m256i right = _mm256_loadu_si256((const __m256i*)(prefixSums + j + 8 * part + kernelSize));
+            const __m256i left = _mm256_loadu_si256((const __m256i*)(prefixSums + j + 8 * part));
+            quotients[part] = avx2Divide8(_mm256_sub_epi32(right, left), half, multiplier, shift);
+        }
+        // Saturating narrow uint32 -> int16 -> uint8, packs works per 128-bit lane so restore the order first
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(quotients[0], quotients[1]), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*)(outputRow + j), _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1)));
+    }
+    for (; j < width; j++) {
+        outputRow[j] = boxDivide(prefixSums[j + kernelSize] - prefixSums[j], divisor);
+    }
+}
+
+const BoxRowKernels* avx2BoxRowKernels() {
+    static const BoxRowKernels kernels = { SIMD_AVX2, avx2AddRow, avx2SubtractRow, avx2SlideRow, avx2PrefixSum, avx2AverageRow };
+    return &kernels;
+}
+#else
+const BoxRowKernels* avx2BoxRowKernels() {
+    return nullptr;
+}
+#endif
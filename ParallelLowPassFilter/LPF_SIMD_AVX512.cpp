@@ -0,0 +1,99 @@
+#include "LPF_SIMD.h"
+
+#if defined(LPF_X86)
+#include <immintrin.h>
+
+// Add 16 pixels to 16 column sums, widening uint8 -> uint32
+LPF_TARGET("avx512f") static inline __m512i avx512Widen16(const uchar* row) {
+    return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)row));
+}
+
+LPF_TARGET("avx512f") static void avx512AddRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_si512(columnSums + i, _mm512_add_epi32(_mm512_loadu_si512(columnSums + i), avx512Widen16(row + i)));
+    }
+    for (; i < count; i++) {
+        columnSums[i] += row[i];
+    }
+}
+
+LPF_TARGET("avx512f") static void avx512SubtractRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_si512(columnSums + i, _mm512_sub_epi32(_mm512_loadu_si512(columnSums + i), avx512Widen16(row + i)));
+    }
+    for (; i < count; i++) {
+        columnSums[i] -= row[i];
+    }
+}
+
+LPF_TARGET("avx512f") static void avx512SlideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512i difference = _mm512_sub_epi32(avx512Widen16(addedRow + i), avx512Widen16(removedRow + i));
+        _mm512_storeu_si512(columnSums + i, _mm512_add_epi32(_mm512_loadu_si512(columnSums + i), difference));
+    }
+    for (; i < count; i++) {
+        columnSums[i] += addedRow[i] - removedRow[i];
+    }
+}
+
+// Scan across the whole register by shifting in zero lanes, then add the carry of the previous block
+LPF_TARGET("avx512f") static void avx512PrefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lastLane = _mm512_set1_epi32(15);
+    __m512i carry = zero;
+    prefixSums[0] = 0;
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i v = _mm512_loadu_si512(columnSums + i);
+        v = _mm512_add_epi32(v, _mm512_alignr_epi32(v, zero, 15));
+        v = _mm512_add_epi32(v, _mm512_alignr_epi32(v, zero, 14));
+        v = _mm512_add_epi32(v, _mm512_alignr_epi32(v, zero, 12));
+        v = _mm512_add_epi32(v, _mm512_alignr_epi32(v, zero, 8));
+        v = _mm512_add_epi32(v, carry);
+        _mm512_storeu_si512(prefixSums + i + 1, v);
+        carry = _mm512_permutexvar_epi32(lastLane, v);
+    }
+    unsigned int sum = (unsigned int)_mm_cvtsi128_si32(_mm512_castsi512_si128(carry));
+    for (; i < count; i++) {
+        sum += columnSums[i];
+        prefixSums[i + 1] = sum;
+    }
+}
+
+// Divide 16 window sums by the kernel area with the multiply-shift of boxDivide, even and odd lanes as in sse2Divide4
+LPF_TARGET("avx512f") static inline __m512i avx512Divide16(const __m512i sums, const __m512i half, const __m512i multiplier, const __m128i shift) {
+    const __m512i dividends = _mm512_add_epi32(sums, half);
+    const __m512i even = _mm512_srl_epi64(_mm512_mul_epu32(dividends, multiplier), shift);
+    const __m512i odd = _mm512_srl_epi64(_mm512_mul_epu32(_mm512_srli_epi64(dividends, 32), multiplier), shift);
+    return _mm512_or_si512(even, _mm512_slli_epi64(odd, 32));
+}
+
+LPF_TARGET("avx512f") static void avx512AverageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) {
+    const BoxDivisor divisor = boxDivisor(kernelSize);
+    const __m512i half = _mm512_set1_epi32((int)divisor.half);
+    const __m512i multiplier = _mm512_set1_epi32((int)divisor.multiplier);
+    const __m128i shift = _mm_cvtsi32_si128(divisor.shift);
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        const __m512i right = _mm512_loadu_si512(prefixSums + j + kernelSize);
+        const __m512i left = _mm512_loadu_si512(prefixSums + j);
+        // Saturating narrow uint32 -> uint8
+        _mm_storeu_si128((__m128i*)(outputRow + j), _mm512_cvtusepi32_epi8(avx512Divide16(_mm512_sub_epi32(right, left), half, multiplier, shift)));
+    }
+    for (; j < width; j++) {
+        outputRow[j] = boxDivide(prefixSums[j + kernelSize] - prefixSums[j], divisor);
+    }
+}
+
+const BoxRowKernels* avx512BoxRowKernels() {
+    static const BoxRowKernels kernels = { SIMD_AVX512, avx512AddRow, avx512SubtractRow, avx512SlideRow, avx512PrefixSum, avx512AverageRow };
+    return &kernels;
+}
+#else
+const BoxRowKernels* avx512BoxRowKernels() {
+    return nullptr;
+}
+#endif
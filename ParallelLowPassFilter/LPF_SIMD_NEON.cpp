@@ -0,0 +1,96 @@
+#include "LPF_SIMD.h"
+
+#if defined(LPF_NEON)
+#include <arm_neon.h>
+
+// Widen 8 pixels to uint16 and add them to, or remove them from, 8 column sums
+static inline void neonAccumulate8(unsigned int* columnSums, const uint16x8_t pixels, const bool subtract) {
+    uint32x4_t low = vld1q_u32(columnSums);
+    uint32x4_t high = vld1q_u32(columnSums + 4);
+    if (subtract) {
+        low = vsubw_u16(low, vget_low_u16(pixels));
+        high = vsubw_u16(high, vget_high_u16(pixels));
+    }
+    else {
+        low = vaddw_u16(low, vget_low_u16(pixels));
+        high = vaddw_u16(high, vget_high_u16(pixels));
+    }
+    vst1q_u32(columnSums, low);
+    vst1q_u32(columnSums + 4, high);
+}
+
+static void neonAddRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        neonAccumulate8(columnSums + i, vmovl_u8(vld1_u8(row + i)), false);
+    }
+    for (; i < count; i++) {
+        columnSums[i] += row[i];
+    }
+}
+
+static void neonSubtractRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        neonAccumulate8(columnSums + i, vmovl_u8(vld1_u8(row + i)), true);
+    }
+    for (; i < count; i++) {
+        columnSums[i] -= row[i];
+    }
+}
+
+static void neonSlideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        neonAccumulate8(columnSums + i, vmovl_u8(vld1_u8(addedRow + i)), false);
+        neonAccumulate8(columnSums + i, vmovl_u8(vld1_u8(removedRow + i)), true);
+    }
+    for (; i < count; i++) {
+        columnSums[i] += addedRow[i] - removedRow[i];
+    }
+}
+
+// The horizontal pass stays scalar on NEON, the compiler vectorizes the division loop well enough
+static void neonPrefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) {
+    unsigned int sum = 0;
+    prefixSums[0] = 0;
+    for (int i = 0; i < count; i++) {
+        sum += columnSums[i];
+        prefixSums[i + 1] = sum;
+    }
+}
+
+// Divide 4 window sums by the kernel area with the multiply-shift of boxDivide, vmull widens two lanes at a time
+static inline uint32x4_t neonDivide4(const uint32x4_t sums, const uint32x4_t half, const uint32x2_t multiplier, const int64x2_t shift) {
+    const uint32x4_t dividends = vaddq_u32(sums, half);
+    const uint64x2_t low = vshlq_u64(vmull_u32(vget_low_u32(dividends), multiplier), shift);
+    const uint64x2_t high = vshlq_u64(vmull_u32(vget_high_u32(dividends), multiplier), shift);
+    return vcombine_u32(vmovn_u64(low), vmovn_u64(high));
+}
+
+static void neonAverageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) {
+    const BoxDivisor divisor = boxDivisor(kernelSize);
+    const uint32x4_t half = vdupq_n_u32(divisor.half);
+    const uint32x2_t multiplier = vdup_n_u32(divisor.multiplier);
+    const int64x2_t shift = vdupq_n_s64(-divisor.shift); // a negative count shifts right
+    int j = 0;
+    for (; j + 8 <= width; j += 8) {
+        const uint32x4_t low = neonDivide4(vsubq_u32(vld1q_u32(prefixSums + j + kernelSize), vld1q_u32(prefixSums + j)), half, multiplier, shift);
+        const uint32x4_t high = neonDivide4(vsubq_u32(vld1q_u32(prefixSums + j + 4 + kernelSize), vld1q_u32(prefixSums + j + 4)), half, multiplier, shift);
+        // Every quotient is at most 255, so plain narrowing is enough
+        vst1_u8(outputRow + j, vmovn_u16(vcombine_u16(vmovn_u32(low), vmovn_u32(high))));
+    }
+    for (; j < width; j++) {
+        outputRow[j] = boxDivide(prefixSums[j + kernelSize] - prefixSums[j], divisor);
+    }
+}
+
+const BoxRowKernels* neonBoxRowKernels() {
+    static const BoxRowKernels kernels = { SIMD_NEON, neonAddRow, neonSubtractRow, neonSlideRow, neonPrefixSum, neonAverageRow };
+    return &kernels;
+}
+#else
+const BoxRowKernels* neonBoxRowKernels() {
+    return nullptr;
+}
+#endif
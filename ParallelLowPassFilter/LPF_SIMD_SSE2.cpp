@@ -0,0 +1,111 @@
+#include "LPF_SIMD.h"
+
+#if defined(LPF_X86)
+#include <emmintrin.h>
+
+// Add 16 pixels to 16 column sums, widening uint8 -> uint16 -> uint32
+LPF_TARGET("sse2") static inline void sse2Accumulate16(unsigned int* columnSums, const __m128i pixels, const bool subtract) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+    const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+    __m128i widened[4] = { _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero), _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+
+    for (int part = 0; part < 4; part++) {
+        __m128i* sums = (__m128i*)(columnSums + 4 * part);
+        const __m128i current = _mm_loadu_si128(sums);
+        _mm_storeu_si128(sums, subtract ? _mm_sub_epi32(current, widened[part]) : _mm_add_epi32(current, widened[part]));
+    }
+}
+
+LPF_TARGET("sse2") static void sse2AddRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        sse2Accumulate16(columnSums + i, _mm_loadu_si128((const __m128i*)(row + i)), false);
+    }
+    for (; i < count; i++) {
+        columnSums[i] += row[i];
+    }
+}
+
+LPF_TARGET("sse2") static void sse2SubtractRow(unsigned int* columnSums, const uchar* row, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        sse2Accumulate16(columnSums + i, _mm_loadu_si128((const __m128i*)(row + i)), true);
+    }
+    for (; i < count; i++) {
+        columnSums[i] -= row[i];
+    }
+}
+
+LPF_TARGET("sse2") static void sse2SlideRow(unsigned int* columnSums, const uchar* addedRow, const uchar* removedRow, const int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        sse2Accumulate16(columnSums + i, _mm_loadu_si128((const __m128i*)(addedRow + i)), false);
+        sse2Accumulate16(columnSums + i, _mm_loadu_si128((const __m128i*)(removedRow + i)), true);
+    }
+    for (; i < count; i++) {
+        columnSums[i] += addedRow[i] - removedRow[i];
+    }
+}
+
+// In-register scan of 4 lanes, then carry the last lane into the next block
+LPF_TARGET("sse2") static void sse2PrefixSum(unsigned int* prefixSums, const unsigned int* columnSums, const int count) {
+    __m128i carry = _mm_setzero_si128();
+    prefixSums[0] = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(columnSums + i));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        _mm_storeu_si128((__m128i*)(prefixSums + i + 1), v);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    unsigned int sum = (unsigned int)_mm_cvtsi128_si32(carry);
+    for (; i < count; i++) {
+        sum += columnSums[i];
+        prefixSums[i + 1] = sum;
+    }
+}
+
+// Divide 4 window sums by the kernel area with the multiply-shift of boxDivide. mul_epu32 multiplies the even
+// lanes into 64 bits, so the odd lanes are shifted down, multiplied separately and merged back after the shift.
+LPF_TARGET("sse2") static inline __m128i sse2Divide4(const __m128i sums, const __m128i half, const __m128i multiplier, const __m128i shift) {
+    const __m128i dividends = _mm_add_epi32(sums, half);
+    const __m128i even = _mm_srl_epi64(_mm_mul_epu32(dividends, multiplier), shift);
+    const __m128i odd = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(dividends, 32), multiplier), shift);
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+LPF_TARGET("sse2") static void sse2AverageRow(uchar* outputRow, const unsigned int* prefixSums, const int width, const int kernelSize) {
+    const BoxDivisor divisor = boxDivisor(kernelSize);
+    const __m128i half = _mm_set1_epi32((int)divisor.half);
+    const __m128i multiplier = _mm_set1_epi32((int)divisor.multiplier);
+    const __m128i shift = _mm_cvtsi32_si128(divisor.shift);
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m128i quotients[4];
+        for (int part = 0; part < 4; part++) {
+            const __m128i right = _mm_loadu_si128((const __m128i*)(prefixSums + j + 4 * part + kernelSize));
+            const __m128i left = _mm_loadu_si128((const __m128i*)(prefixSums + j + 4 * part));
+            quotients[part] = sse2Divide4(_mm_sub_epi32(right, left), half, multiplier, shift);
+        }
+        // Saturating narrow uint32 -> int16 -> uint8
+        const __m128i low = _mm_packs_epi32(quotients[0], quotients[1]);
+        const __m128i high = _mm_packs_epi32(quotients[2], quotients[3]);
+        _mm_storeu_si128((__m128i*)(outputRow + j), _mm_packus_epi16(low, high));
+    }
+    for (; j < width; j++) {
+        outputRow[j] = boxDivide(prefixSums[j + kernelSize] - prefixSums[j], divisor);
+    }
+}
+
+const BoxRowKernels* sse2BoxRowKernels() {
+    static const BoxRowKernels kernels = { SIMD_SSE2, sse2AddRow, sse2SubtractRow, sse2SlideRow, sse2PrefixSum, sse2AverageRow };
+    return &kernels;
+}
+#else
+const BoxRowKernels* sse2BoxRowKernels() {
+    return nullptr;
+}
+#endif
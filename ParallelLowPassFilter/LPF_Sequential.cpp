@@ -1,78 +1,61 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
-#include <opencv2/opencv.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgcodecs/imgcodecs.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/core/utils/logger.hpp>
 #include <chrono>
 
+#include "LPF_Sequential.h"
+#include "LPF_OpenMP.h"
+
 using namespace cv;
 using namespace std;
 
-Mat seqLowPassFilter(const Mat& inputImage, const int kernelSize)
+void seqLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int borderType)
 {
-    float filter_value = (1 / (float)(kernelSize * kernelSize));
+    TraceScope scope("compute");
+
+    // Filter the whole image in one region, the engine reads the pixels outside the image through the border
+    kernelLowPassFilter(inputImage, outputImage, kernel, Rect(0, 0, inputImage.cols, inputImage.rows), borderType);
+}
 
-    // Perform zero padding on the input image
-    int paddingSize = kernelSize / 2;
-    Mat paddedImage;
-    copyMakeBorder(inputImage, paddedImage, paddingSize, paddingSize, paddingSize, paddingSize, BORDER_CONSTANT, Scalar(0));
+void seqLowPassFilter(const Mat& inputImage, Mat& outputImage, const int kernelSize)
+{
+    seqLowPassFilter(inputImage, outputImage, FilterKernel::box(kernelSize));
+}
 
+Mat seqLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int borderType)
+{
     // Create an output image with the same size as the input image
     Mat outputImage(inputImage.size(), inputImage.type());
 
-    // Perform convolution on the padded image using the filter kernel
-    for (int i = paddingSize; i < paddedImage.rows - paddingSize; i++) {
-        for (int j = paddingSize; j < paddedImage.cols - paddingSize; j++) {
-            float sum = 0.0;
-            for (int k = -paddingSize; k <= paddingSize; k++) {
-                for (int l = -paddingSize; l <= paddingSize; l++) {
-                    float pixelValue = paddedImage.at<uchar>(i + k, j + l);
-                    sum += pixelValue * filter_value;
-                }
-            }
-            outputImage.at<uchar>(i - paddingSize, j - paddingSize) = sum;
-        }
-    }
+    seqLowPassFilter(inputImage, outputImage, kernel, borderType);
 
     return outputImage;
 }
 
-namespace sequential
+Mat seqLowPassFilter(const Mat& inputImage, const int kernelSize)
 {
-    Mat process(const Mat& image, const int kernal_size, const bool waitFlag) {
-        // Start the timer
-        auto start_time = chrono::high_resolution_clock::now();
-
-        // Perform convolution on the input image using the filter kernel
-        Mat outputImage = seqLowPassFilter(image, kernal_size);
-
-        // Stop the timer
-        auto end_time = chrono::high_resolution_clock::now();
+    return seqLowPassFilter(inputImage, FilterKernel::box(kernelSize));
+}
 
-        // Print the elapsed time in milliseconds
-        auto elapsed_time = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-        printf("Sequential Elapsed time: %lld milliseconds\n", elapsed_time.count());
-        fflush(stdout);
+void seqMultiPassLowPassFilter(const Mat& inputImage, Mat& outputImage, const FilterKernel& kernel, const int passes, const int borderType)
+{
+    TraceScope scope("compute");
 
-        // Display the input and output images
-        imshow("Original image", image);
-        imshow("Sequential Output image", outputImage);
-        imwrite("seqImage.png", outputImage);
+    // The cache sized tiles of the OpenMP method one after the other, every tile through all passes
+    for (const Rect& tile : makeTiles(Rect(0, 0, inputImage.cols, inputImage.rows), kernel.size(), 1, inputImage.type(), passes)) {
+        Mat outputTile = outputImage(tile);
+        passLowPassFilter(inputImage, Point(0, 0), inputImage.size(), outputTile, tile, kernel, passes, borderType);
+    }
+}
 
-        // Wait for the user to press any key
-        if (waitFlag) {
-            waitKey(0);
-        }
+Mat seqMultiPassLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int borderType)
+{
+    // Create an output image with the same size as the input image
+    Mat outputImage(inputImage.size(), inputImage.type());
 
-        // Return the output image
-        return outputImage;
-    }
+    seqMultiPassLowPassFilter(inputImage, outputImage, kernel, passes, borderType);
 
-    Mat process(const Mat& image, const int kernal_size) {
-        // Perform convolution on the input image
-        return process(image, kernal_size, true);
-    }
-}
\ No newline at end of file
+    return outputImage;
+}
@@ -2,21 +2,19 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
-#include <opencv2/opencv.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgcodecs/imgcodecs.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/core/utils/logger.hpp>
 #include <chrono>
 
-using namespace cv;
-using namespace std;
+#include "LPF_Kernel.h"
 
-Mat seqLowPassFilter(const Mat& inputImage, const int kernelSize);
-
-namespace sequential
-{
-	Mat process(const Mat& image, const int kernal_size, const bool waitFlag);
-	Mat process(const Mat& image, const int kernal_size);
-}
+// Filter into an output image the caller owns, for example a mapped file. The kernelSize versions filter with
+// the box kernel and a zero border.
+void seqLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int borderType = cv::BORDER_CONSTANT);
+void seqLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const int kernelSize);
+cv::Mat seqLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat seqLowPassFilter(const cv::Mat& inputImage, const int kernelSize);
 
+// Filter with passes passes of the kernel, as if the output of every pass was filtered again
+void seqMultiPassLowPassFilter(const cv::Mat& inputImage, cv::Mat& outputImage, const FilterKernel& kernel, const int passes, const int borderType = cv::BORDER_CONSTANT);
+cv::Mat seqMultiPassLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int borderType = cv::BORDER_CONSTANT);
@@ -0,0 +1,67 @@
+#include "LPF_Stream.h"
+
+using namespace cv;
+using namespace std;
+
+bool streamLowPassFilter(const String& inputPath, const String& outputPath, const int kernelSize, const int bandHeight, const int num_of_threads) {
+    CV_Assert(bandHeight > 0);
+
+    ifstream inputFile(inputPath, ios::binary);
+    ImageFileHeader inputHeader;
+    if (!inputFile || !readImageHeader(inputFile, inputHeader)) {
+        return false;
+    }
+
+    ofstream outputFile(outputPath, ios::binary);
+    ImageFileHeader outputHeader = inputHeader;
+    if (!outputFile || !writeImageHeader(outputFile, outputHeader)) {
+        return false;
+    }
+
+    const int rows = inputHeader.rows;
+    const int cols = inputHeader.cols;
+    const int paddingSize = kernelSize / 2;
+
+    // The window holds input rows [windowTop, windowTop + windowRows), which covers the current band and its
+    // halo. Rows above the first and below the last image row are never loaded, the engine treats them as zero.
+    Mat window(bandHeight + 2 * paddingSize, cols, inputHeader.type);
+    Mat outputBand(bandHeight, cols, inputHeader.type);
+    int windowTop = 0;
+    int windowRows = 0;
+
+    for (int bandTop = 0; bandTop < rows; bandTop += bandHeight) {
+        const int bandRows = min(bandHeight, rows - bandTop);
+
+        // Drop the rows the band no longer needs and shift the ones it still needs to the top of the window
+        const int neededTop = max(bandTop - paddingSize, 0);
+        const int keptRows = max(windowTop + windowRows - neededTop, 0);
+        if (keptRows > 0 && neededTop > windowTop) {
+            memmove(window.ptr(0), window.ptr(neededTop - windowTop), keptRows * window.step);
+        }
+        windowTop = neededTop;
+        windowRows = keptRows;
+
+        // Read the rows of the band and of the halo below it
+        const int neededBottom = min(bandTop + bandRows + paddingSize, rows);
+        if (neededBottom > windowTop + windowRows) {
+            Mat newRows = window.rowRange(windowRows, neededBottom - windowTop);
+            TraceScope scope("read");
+            if (!readImageRows(inputFile, inputHeader, windowTop + windowRows, newRows)) {
+                return false;
+            }
+            windowRows = neededBottom - windowTop;
+        }
+
+        // Filter the band and write it out
+        Mat outputRows = outputBand.rowRange(0, bandRows);
+        TraceScope computeScope("compute");
+        openMPLowPassFilter(window.rowRange(0, windowRows), outputRows, kernelSize, Rect(0, bandTop - windowTop, cols, bandRows), num_of_threads);
+        computeScope.end();
+        TraceScope writeScope("write");
+        if (!writeImageRows(outputFile, outputHeader, bandTop, outputRows)) {
+            return false;
+        }
+    }
+
+    return true;
+}
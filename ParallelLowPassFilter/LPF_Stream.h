@@ -0,0 +1,14 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include <chrono>
+
+#include "LPF_ImageIO.h"
+#include "LPF_OpenMP.h"
+
+// Filter an image file that does not have to fit in memory. Bands of bandHeight rows are read into a sliding
+// window that also holds the kernelSize / 2 rows above and below the band, filtered with the OpenMP tiles and
+// written out before the next band is read. Peak memory is O(width * (bandHeight + kernelSize)).
+bool streamLowPassFilter(const cv::String& inputPath, const cv::String& outputPath, const int kernelSize, const int bandHeight, const int num_of_threads);
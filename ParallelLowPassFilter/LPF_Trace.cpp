@@ -0,0 +1,215 @@
+#include "LPF_Trace.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+struct TraceEvent
+{
+    const char* name;
+    double startMicroseconds;
+    double durationMicroseconds;
+    long long cycles;                  // -1 without hardware counters
+    long long instructions;
+};
+
+// The events of one thread. The buffers belong to the trace and outlive their threads, so the events of the
+// batch pipeline threads are still there when the trace is written.
+struct ThreadTrace
+{
+    int thread;
+    vector<TraceEvent> events;
+};
+
+static atomic<bool> tracing(false);
+static atomic<bool> countersEnabled(false);
+static mutex traceMutex;
+static vector<unique_ptr<ThreadTrace>> threadTraces;
+
+// The steady clock measures the scopes, shifted to the wall clock once so that processes can be lined up
+static double wallClockOffset = 0;
+
+static double steadyMicroseconds() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ThreadTrace& threadTrace() {
+    thread_local ThreadTrace* trace = nullptr;
+    if (trace == nullptr) {
+        lock_guard<mutex> lock(traceMutex);
+        threadTraces.push_back(unique_ptr<ThreadTrace>(new ThreadTrace()));
+        trace = threadTraces.back().get();
+        trace->thread = (int)threadTraces.size() - 1;
+    }
+    return *trace;
+}
+
+// Cycle and instruction counters of the calling thread, opened on its first scope and closed when it ends
+class ThreadCounters
+{
+public:
+    ~ThreadCounters() {
+#if defined(__linux__)
+        if (instructionCounter >= 0) {
+            close(instructionCounter);
+        }
+        if (cycleCounter >= 0) {
+            close(cycleCounter);
+        }
+#endif
+    }
+
+    bool read(long long& cycles, long long& instructions) {
+#if defined(__linux__)
+        if (!opened) {
+            opened = true;
+            cycleCounter = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+            instructionCounter = cycleCounter >= 0 ? openCounter(PERF_COUNT_HW_INSTRUCTIONS, cycleCounter) : -1;
+        }
+        if (instructionCounter < 0) {
+            return false;
+        }
+
+        // Both counters are read at once as a group: the number of counters, then their values
+        unsigned long long values[3];
+        if (::read(cycleCounter, values, sizeof(values)) != (ssize_t)sizeof(values)) {
+            return false;
+        }
+        cycles = (long long)values[1];
+        instructions = (long long)values[2];
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    static int openCounter(const unsigned long long config, const int group) {
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = config;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+        return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, group, 0);
+    }
+#endif
+
+    bool opened = false;
+    int cycleCounter = -1;
+    int instructionCounter = -1;
+};
+
+static ThreadCounters& threadCounters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+void startTrace(const bool hardwareCounters) {
+    lock_guard<mutex> lock(traceMutex);
+    for (unique_ptr<ThreadTrace>& trace : threadTraces) {
+        trace->events.clear();
+    }
+    wallClockOffset = chrono::duration<double, micro>(chrono::system_clock::now().time_since_epoch()).count() - steadyMicroseconds();
+    countersEnabled = hardwareCounters;
+    tracing = true;
+}
+
+void stopTrace() {
+    tracing = false;
+}
+
+bool isTracing() {
+    return tracing;
+}
+
+TraceScope::TraceScope(const char* name) : scopeName(name), active(tracing.load(memory_order_relaxed)) {
+    if (active) {
+        threadTrace(); // Threads are numbered in the order of their first scope
+        counting = countersEnabled && threadCounters().read(startCycles, startInstructions);
+        startMicroseconds = steadyMicroseconds();
+    }
+}
+
+void TraceScope::end() {
+    if (!active) {
+        return;
+    }
+    active = false;
+    const double endMicroseconds = steadyMicroseconds();
+    long long cycles = -1, instructions = -1;
+    if (counting && threadCounters().read(cycles, instructions)) {
+        cycles -= startCycles;
+        instructions -= startInstructions;
+    }
+    else {
+        cycles = instructions = -1;
+    }
+    TraceEvent event = { scopeName, startMicroseconds + wallClockOffset, endMicroseconds - startMicroseconds, cycles, instructions };
+    threadTrace().events.push_back(event);
+}
+
+double traceStartMicroseconds() {
+    lock_guard<mutex> lock(traceMutex);
+    double firstMicroseconds = HUGE_VAL;
+    for (const unique_ptr<ThreadTrace>& trace : threadTraces) {
+        for (const TraceEvent& event : trace->events) {
+            firstMicroseconds = min(firstMicroseconds, event.startMicroseconds);
+        }
+    }
+    return firstMicroseconds;
+}
+
+String traceEvents(const int processId, const double originMicroseconds) {
+    ostringstream events;
+    char line[512];
+    snprintf(line, sizeof(line), "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}}", processId, processId);
+    events << line;
+
+    lock_guard<mutex> lock(traceMutex);
+    for (const unique_ptr<ThreadTrace>& trace : threadTraces) {
+        if (trace->events.empty()) {
+            continue;
+        }
+        snprintf(line, sizeof(line), ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}", processId, trace->thread, trace->thread);
+        events << line;
+        for (const TraceEvent& event : trace->events) {
+            snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"cat\": \"lpf\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                event.name, processId, trace->thread, event.startMicroseconds - originMicroseconds, event.durationMicroseconds);
+            events << line;
+            if (event.cycles >= 0) {
+                snprintf(line, sizeof(line), ", \"args\": {\"cycles\": %lld, \"instructions\": %lld}", event.cycles, event.instructions);
+                events << line;
+            }
+            events << "}";
+        }
+    }
+    return events.str();
+}
+
+bool writeTraceFile(const String& path, const vector<String>& processEvents) {
+    ofstream file(path);
+    file << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < processEvents.size(); i++) {
+        file << (i > 0 ? ",\n" : "") << processEvents[i];
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    return (bool)file;
+}
+
+bool writeTrace(const String& path) {
+    return writeTraceFile(path, vector<String>{ traceEvents(0, traceStartMicroseconds()) });
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <vector>
+
+// A timeline of the phases of the filters: scatter, halo exchange, padding, compute, gather, reads and writes,
+// per thread and per process. Every phase is a TraceScope that records when it started and how long it took into
+// a buffer of its own thread, so recording takes no lock. Tracing is off by default, and a scope then costs a
+// single test.
+
+// Start recording, dropping the events of an earlier trace. Call it while no filter is running. With
+// hardwareCounters, every scope also counts the CPU cycles and instructions of its thread with perf_event, on
+// Linux when the kernel allows it (see /proc/sys/kernel/perf_event_paranoid), and records none elsewhere.
+void startTrace(const bool hardwareCounters = false);
+void stopTrace();
+bool isTracing();
+
+// Records the time from its construction to its destruction, or to end(), as one event of the calling thread. The
+// name must outlive the trace, like a string literal.
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name);
+	~TraceScope() { end(); }
+
+	// End the phase before the scope does
+	void end();
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* scopeName;
+	bool active;
+	bool counting = false;
+	double startMicroseconds = 0;
+	long long startCycles = 0;
+	long long startInstructions = 0;
+};
+
+// The start of the first event of this process in microseconds of the wall clock, HUGE_VAL without any
+double traceStartMicroseconds();
+
+// The events of this process as Chrome trace JSON objects separated by commas, with processId as their process
+// and their times in microseconds from originMicroseconds
+cv::String traceEvents(const int processId, const double originMicroseconds);
+
+// Write the events of one or more processes, as given by traceEvents, to path as a Chrome trace, to open in
+// chrome://tracing or https://ui.perfetto.dev. Every process gets its own row and every thread its own track.
+bool writeTraceFile(const cv::String& path, const std::vector<cv::String>& processEvents);
+
+// Write the events of this process alone, with times from its first event. The MPI version in LPF_MPI gathers the
+// events of every rank.
+bool writeTrace(const cv::String& path);
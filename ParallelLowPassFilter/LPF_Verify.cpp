@@ -0,0 +1,421 @@
+#include "LPF_Verify.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+using namespace cv;
+using namespace std;
+
+template <typename T>
+static void referencePass(const Mat& inputImage, Mat& outputImage, const Mat& weights, const int borderType) {
+    const int kernelSize = weights.rows;
+    const int paddingSize = kernelSize / 2;
+    const int channels = inputImage.channels();
+    vector<double> sums(channels);
+
+    for (int y = 0; y < inputImage.rows; y++) {
+        for (int x = 0; x < inputImage.cols; x++) {
+            fill(sums.begin(), sums.end(), 0.0);
+            for (int a = 0; a < kernelSize; a++) {
+                const int sourceRow = borderInterpolate(y + a - paddingSize, inputImage.rows, borderType);
+                for (int b = 0; b < kernelSize && sourceRow >= 0; b++) {
+                    const int sourceColumn = borderInterpolate(x + b - paddingSize, inputImage.cols, borderType);
+                    if (sourceColumn < 0) {
+                        continue;
+                    }
+                    const T* pixel = inputImage.ptr<T>(sourceRow) + sourceColumn * channels;
+                    for (int c = 0; c < channels; c++) {
+                        sums[c] += weights.at<double>(a, b) * pixel[c];
+                    }
+                }
+            }
+            for (int c = 0; c < channels; c++) {
+                outputImage.ptr<T>(y)[x * channels + c] = saturate_cast<T>(sums[c]);
+            }
+        }
+    }
+}
+
+Mat referenceLowPassFilter(const Mat& inputImage, const FilterKernel& kernel, const int passes, const int borderType) {
+    // The box weights are exact here, the box engine divides its integer sums exactly
+    Mat weights;
+    if (kernel.isBox()) {
+        weights = Mat(kernel.size(), kernel.size(), CV_64FC1, Scalar::all(1.0 / ((double)kernel.size() * kernel.size())));
+    }
+    else {
+        kernel.weights().convertTo(weights, CV_64F);
+    }
+
+    Mat image = inputImage;
+    for (int pass = 0; pass < passes; pass++) {
+        Mat outputImage(image.size(), image.type());
+        switch (image.depth()) {
+        case CV_8U:
+            referencePass<uchar>(image, outputImage, weights, borderType);
+            break;
+        case CV_16U:
+            referencePass<ushort>(image, outputImage, weights, borderType);
+            break;
+        default:
+            referencePass<float>(image, outputImage, weights, borderType);
+            break;
+        }
+        image = outputImage;
+    }
+    return image;
+}
+
+struct VerifyKernel
+{
+    const char* name;
+    FilterKernel kernel;
+};
+
+static vector<VerifyKernel> verifyKernels() {
+    // Non-separable weights with negative ones, for the direct loop
+    Mat custom(5, 5, CV_32FC1);
+    RNG rng(0x5eed);
+    rng.fill(custom, RNG::UNIFORM, Scalar(-0.02), Scalar(0.1));
+
+    // Both diagonals, a sparse kernel that is not the product of two 1D kernels
+    Mat cross(7, 7, CV_32FC1, Scalar::all(0));
+    for (int i = 0; i < cross.rows; i++) {
+        cross.at<float>(i, i) = cross.at<float>(i, cross.cols - 1 - i) = 1.0f / 13;
+    }
+
+    return {
+        { "box1", FilterKernel::box(1) },
+        { "box3", FilterKernel::box(3) },
+        { "box9", FilterKernel::box(9) },
+        { "box15", FilterKernel::box(15) },
+        { "gaussian5", FilterKernel::gaussian(5) },
+        { "gaussian7", FilterKernel::gaussian(7, 2.0) },
+        { "custom5", FilterKernel::custom(custom) },
+        { "cross7", FilterKernel::custom(cross) },
+    };
+}
+
+static const struct { const char* name; int type; } verifyBorders[] = {
+    { "constant", BORDER_CONSTANT }, { "replicate", BORDER_REPLICATE }, { "reflect", BORDER_REFLECT },
+    { "wrap", BORDER_WRAP }, { "reflect101", BORDER_REFLECT_101 }
+};
+
+// The largest difference between two images of any type, over all channels. Images of another size or type, such
+// as a file that could not be read back, are infinitely different.
+static double maxDifference(const Mat& image1, const Mat& image2) {
+    if (image1.size() != image2.size() || image1.type() != image2.type()) {
+        return HUGE_VAL;
+    }
+    if (image1.empty()) {
+        return 0;
+    }
+    return norm(image1.reshape(1), image2.reshape(1), NORM_INF);
+}
+
+// The rectangles an incremental update changes: one in the middle and the two corner pixels, which reach across
+// the border
+static vector<Rect> verifyChangedRects(const Size& size) {
+    return { Rect(size.width / 3, size.height / 3, max(size.width / 4, 1), max(size.height / 4, 1)),
+        Rect(0, 0, 1, 1), Rect(size.width - 1, size.height - 1, 1, 1) };
+}
+
+// A PGM or PFM file of the image as stored, and an image read back from one
+static bool writeVerifyFile(const String& path, const Mat& image) {
+    ofstream file(path, ios::binary);
+    ImageFileHeader header;
+    header.format = image.type() == CV_8UC1 ? FORMAT_PGM : FORMAT_PFM;
+    header.rows = image.rows;
+    header.cols = image.cols;
+    header.type = image.type();
+    return file && writeImageHeader(file, header) && writeImageRows(file, header, 0, image);
+}
+
+static Mat readVerifyFile(const String& path) {
+    ifstream file(path, ios::binary);
+    ImageFileHeader header;
+    Mat image;
+    if (file && readImageHeader(file, header)) {
+        image.create(header.rows, header.cols, header.type);
+        if (!readImageRows(file, header, 0, image)) {
+            image.release();
+        }
+    }
+    return image;
+}
+
+// The frames of the batch pipeline, kept in memory
+class VerifyFrameSource : public FrameSource
+{
+public:
+    explicit VerifyFrameSource(const vector<Mat>& frames) : frames(frames), nextFrame(0) {}
+    bool isOpened() const override { return true; }
+    bool read(Mat& frame) override {
+        if (nextFrame >= frames.size()) {
+            return false;
+        }
+        frames[nextFrame++].copyTo(frame);
+        return true;
+    }
+
+private:
+    const vector<Mat>& frames;
+    size_t nextFrame;
+};
+
+class VerifyFrameSink : public FrameSink
+{
+public:
+    bool isOpened() const override { return true; }
+    bool write(const Mat& frame) override {
+        frames.push_back(frame.clone());
+        return true;
+    }
+
+    vector<Mat> frames;
+};
+
+int verifyBackends(const BenchmarkOptions& options, const int world_size, const int world_rank, const int collector) {
+    const vector<Size> imageSizes = { Size(1, 1), Size(13, 1), Size(1, 13), Size(2, 2), Size(37, 23), Size(64, 6), Size(101, 67) };
+    const vector<int> imageTypes = { CV_8UC1, CV_8UC3, CV_16UC1, CV_32FC1 };
+    const vector<int> passCounts = { 1, 3 };
+    const vector<VerifyKernel> kernels = verifyKernels();
+    const vector<int> threadCounts = options.threadCounts.empty() ? vector<int>{ 1, 3 } : options.threadCounts;
+    vector<int> rankCounts = options.rankCounts;
+    if (rankCounts.empty()) {
+        for (int ranks = 1; ranks <= world_size; ranks++) {
+            rankCounts.push_back(ranks);
+        }
+    }
+
+    // The incremental, streaming, MPI-IO and batch filters are not benchmarked, they are checked by default
+    // and when asked for by name
+    vector<String> backends = options.backends;
+    if (backends == BenchmarkOptions().backends) {
+        backends.insert(backends.end(), { "incremental", "stream", "mpifile", "batch" });
+    }
+    auto runs = [&](const char* backend) {
+        return find(backends.begin(), backends.end(), backend) != backends.end();
+    };
+
+    // Every process uses the collector's file names, the MPI-IO filter opens the same files on all of them
+    String filePrefix = world_rank == collector ? tempfile() : String();
+    int prefixLength = (int)filePrefix.size();
+    MPI_Bcast(&prefixLength, 1, MPI_INT, collector, MPI_COMM_WORLD);
+    filePrefix.resize(prefixLength);
+    MPI_Bcast(&filePrefix[0], prefixLength, MPI_CHAR, collector, MPI_COMM_WORLD);
+    const String inputPath = filePrefix + "_input", streamPath = filePrefix + "_stream", mpiFilePath = filePrefix + "_mpifile";
+
+    // One communicator and one balanced filter per rank count for the whole suite
+    struct RankGroup
+    {
+        int ranks;
+        MPI_Comm comm;
+        int rank;
+        unique_ptr<BalancedMPILowPassFilter> balancedFilter;
+    };
+    vector<RankGroup> groups;
+    for (int ranks : rankCounts) {
+        ranks = min(ranks, world_size);
+        MPI_Comm comm = splitRanks(ranks, world_size, world_rank, collector);
+        if (comm == MPI_COMM_NULL) {
+            continue;
+        }
+        RankGroup group = { ranks, comm, 0, nullptr };
+        MPI_Comm_rank(comm, &group.rank);
+        group.balancedFilter.reset(new BalancedMPILowPassFilter(ranks, group.rank, 0, comm));
+        groups.push_back(move(group));
+    }
+
+    int checks = 0, failures = 0;
+    for (const Size& size : imageSizes) {
+        for (int type : imageTypes) {
+            // Every process builds the same image, the MPI filters need its size everywhere
+            Mat image(size, type);
+            theRNG() = RNG(0x12345678);
+            randu(image, Scalar::all(0), Scalar::all(CV_MAT_DEPTH(type) == CV_8U ? 256 : CV_MAT_DEPTH(type) == CV_16U ? 65536 : 1));
+            const bool floatPixels = CV_MAT_DEPTH(type) == CV_32F;
+
+            for (const VerifyKernel& verifyKernel : kernels) {
+                const FilterKernel& kernel = verifyKernel.kernel;
+                for (const auto& border : verifyBorders) {
+                    for (int passes : passCounts) {
+                        Mat sequential;
+                        Mat outputImage(image.size(), image.type());
+                        auto check = [&](const char* backend, const Mat& expected, const Mat& actual, const double tolerance, const int threads, const int ranks) {
+                            checks++;
+                            const double difference = maxDifference(expected, actual);
+                            if (!(difference <= tolerance)) {
+                                failures++;
+                                printf("FAIL %s %dx%d %s %s border %s passes %d threads %d ranks %d: max difference %g, allowed %g\n", backend, size.width, size.height,
+                                    benchmarkTypeName(type), verifyKernel.name, border.name, passes, threads, ranks, difference, tolerance);
+                                fflush(stdout);
+                            }
+                        };
+
+                        // Every pass may round the other way than the reference, and that difference spreads through the
+                        // weights of the next passes
+                        double weightSum = 0;
+                        for (int a = 0; a < kernel.size(); a++) {
+                            for (int b = 0; b < kernel.size(); b++) {
+                                weightSum += fabs(kernel.weights().at<float>(a, b));
+                            }
+                        }
+                        double reach = 0;
+                        for (int pass = 0; pass < passes; pass++) {
+                            reach = reach * max(weightSum, 1.0) + 1;
+                        }
+                        const double exactTolerance = floatPixels ? 1e-4 : 0;
+
+                        // The box engine divides integer sums by an odd area with rounding, which never ties, so on
+                        // integer pixels it must match the reference exactly
+                        const double referenceTolerance = floatPixels ? 1e-4 * reach : kernel.isBox() ? 0 : reach;
+
+                        // The file and batch filters take a box size and a zero border, the files hold PGM or PFM pixels
+                        const bool boxCase = kernel.isBox() && border.type == BORDER_CONSTANT && passes == 1;
+                        const bool fileCase = boxCase && (type == CV_8UC1 || type == CV_32FC1);
+
+                        if (world_rank == collector) {
+                            // The sequential filter with every instruction set the CPU supports, the detected one is
+                            // the baseline of the other backends
+                            const Mat reference = referenceLowPassFilter(image, kernel, passes, border.type);
+                            const SIMDLevel activeLevel = getSIMDLevel();
+                            for (SIMDLevel level : supportedSIMDLevels()) {
+                                setSIMDLevel(level);
+                                Mat levelOutput = seqMultiPassLowPassFilter(image, kernel, passes, border.type);
+                                check((String("seq ") + simdLevelName(level)).c_str(), reference, levelOutput, referenceTolerance, 1, 1);
+                                if (level == activeLevel) {
+                                    sequential = levelOutput;
+                                }
+                            }
+                            setSIMDLevel(activeLevel);
+                            if (sequential.empty()) {
+                                sequential = seqMultiPassLowPassFilter(image, kernel, passes, border.type);
+                            }
+                            if (passes > 1) {
+                                // Fused passes give the same image as filtering the output again, pass by pass
+                                Mat repeated = image;
+                                for (int pass = 0; pass < passes; pass++) {
+                                    repeated = seqLowPassFilter(repeated, kernel, border.type);
+                                }
+                                check("repeated", repeated, sequential, exactTolerance, 1, 1);
+                            }
+                            if (runs("openmp")) {
+                                for (int threads : threadCounts) {
+                                    openMPMultiPassLowPassFilter(image, outputImage, kernel, passes, threads, border.type);
+                                    check("openmp", sequential, outputImage, exactTolerance, threads, 1);
+                                }
+                            }
+                            if (runs("numa")) {
+                                for (int threads : threadCounts) {
+                                    numaLowPassFilter(image, outputImage, kernel, passes, threads, 0, border.type);
+                                    check("numa", sequential, outputImage, exactTolerance, threads, 1);
+                                }
+                            }
+                            if (runs("incremental") && passes == 1) {
+                                // Start from an image that differs inside the rectangles and update only them
+                                const vector<Rect> changedRects = verifyChangedRects(size);
+                                Mat changedImage = image.clone();
+                                for (const Rect& rect : changedRects) {
+                                    changedImage(rect).setTo(Scalar::all(1));
+                                }
+                                for (int threads : threadCounts) {
+                                    IncrementalLowPassFilter incrementalFilter(changedImage, kernel, threads, border.type);
+                                    check("incremental", sequential, incrementalFilter.update(image, changedRects), exactTolerance, threads, 1);
+                                }
+                            }
+                            if (fileCase) {
+                                writeVerifyFile(inputPath, image);
+                            }
+                            if (runs("stream") && fileCase) {
+                                // Bands of 4 rows, so most images take several bands with halos across them
+                                for (int threads : threadCounts) {
+                                    const bool written = streamLowPassFilter(inputPath, streamPath, kernel.size(), 4, threads);
+                                    check("stream", sequential, written ? readVerifyFile(streamPath) : Mat(), exactTolerance, threads, 1);
+                                }
+                            }
+                            if (runs("batch") && boxCase) {
+                                // The image and its rows upside down, through a pool of two buffers
+                                vector<Mat> frames(2);
+                                frames[0] = image;
+                                flip(image, frames[1], 0);
+                                for (int threads : threadCounts) {
+                                    VerifyFrameSource source(frames);
+                                    VerifyFrameSink sink;
+                                    batchLowPassFilter(source, &sink, kernel.size(), threads, 2);
+                                    for (size_t i = 0; i < frames.size(); i++) {
+                                        check("batch", i == 0 ? sequential : seqLowPassFilter(frames[i], kernel, border.type), i < sink.frames.size() ? sink.frames[i] : Mat(), exactTolerance, threads, 1);
+                                    }
+                                }
+                            }
+                        }
+
+                        for (RankGroup& group : groups) {
+                            const bool checking = group.rank == 0;
+                            if (runs("mpi")) {
+                                MPIMultiPassLowPassFilter(image, outputImage, kernel, passes, group.ranks, group.rank, 0, group.comm, border.type);
+                                if (checking) {
+                                    check("mpi", sequential, outputImage, exactTolerance, 1, group.ranks);
+                                }
+                            }
+                            if (runs("balanced")) {
+                                // Every process twice as fast as the one before it
+                                vector<double> weights(group.ranks);
+                                for (int rank = 0; rank < group.ranks; rank++) {
+                                    weights[rank] = pow(2.0, rank);
+                                }
+                                group.balancedFilter->setWeights(weights);
+                                group.balancedFilter->filter(image, outputImage, kernel, passes, border.type);
+                                if (checking) {
+                                    check("balanced", sequential, outputImage, exactTolerance, 1, group.ranks);
+                                }
+
+                                // A new filter that shares the rows by the speeds it measures, changing its blocks every frame
+                                BalancedMPILowPassFilter adaptiveFilter(group.ranks, group.rank, 0, group.comm);
+                                for (int frame = 0; frame < 3; frame++) {
+                                    adaptiveFilter.filter(image, outputImage, kernel, passes, border.type);
+                                    if (checking) {
+                                        check("adaptive", sequential, outputImage, exactTolerance, 1, group.ranks);
+                                    }
+                                }
+                            }
+                            if (runs("hybrid")) {
+                                for (int threads : threadCounts) {
+                                    hybridMultiPassLowPassFilter(image, outputImage, kernel, passes, group.ranks, group.rank, 0, threads, group.comm, border.type);
+                                    if (checking) {
+                                        check("hybrid", sequential, outputImage, exactTolerance, threads, group.ranks);
+                                    }
+                                }
+                            }
+                            if (runs("mpifile") && fileCase) {
+                                // The collector wrote the input file before it got here
+                                MPI_Barrier(group.comm);
+                                const bool written = MPIFileLowPassFilter(inputPath, mpiFilePath, kernel.size(), group.ranks, group.rank, 0, group.comm);
+                                if (checking) {
+                                    check("mpifile", sequential, written ? readVerifyFile(mpiFilePath) : Mat(), exactTolerance, 1, group.ranks);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (RankGroup& group : groups) {
+        group.balancedFilter.reset();
+        MPI_Comm_free(&group.comm);
+    }
+    if (world_rank == collector) {
+        remove(inputPath.c_str());
+        remove(streamPath.c_str());
+        remove(mpiFilePath.c_str());
+    }
+
+    MPI_Bcast(&failures, 1, MPI_INT, collector, MPI_COMM_WORLD);
+    if (world_rank == collector) {
+        printf("Verified %d checks, %d failed\n", checks, failures);
+        fflush(stdout);
+    }
+    return failures;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+
+#include "LPF_Benchmark.h"
+#include "LPF_Incremental.h"
+#include "LPF_Stream.h"
+#include "LPF_Batch.h"
+
+// A correctness suite for every backend, run headless with --verify so it can gate changes to the filters. Small
+// synthetic images of awkward shapes, single pixels, 1-row and 1-column strips, odd sizes and images with fewer
+// rows than processes, are filtered with kernels up to wider than the row block of a process, with every border
+// type and fused passes, by every backend at every thread count and every rank count from 1 to the size of
+// MPI_COMM_WORLD. The balanced MPI filter gets uneven weights, so its blocks differ in height. The incremental
+// filter updates a few rectangles of a changed image, and the streaming, MPI-IO and batch filters, which take a
+// box size and a zero border, run on PGM and PFM files and on a pair of frames in memory.
+//
+// The sequential filter, with every instruction set the CPU supports, is checked against referenceLowPassFilter,
+// exactly for box kernels on integer pixels and within rounding otherwise. Every other backend is checked against the sequential filter: exactly for integer
+// pixels, within 1e-4 for float pixels, whose box sums are rounded differently depending on where a block starts.
+
+// A plain per-pixel filter that shares no code with the engines: every output pixel adds up the weights times the
+// pixels borderInterpolate maps them to, in double, and rounds once per pass
+cv::Mat referenceLowPassFilter(const cv::Mat& inputImage, const FilterKernel& kernel, const int passes, const int borderType);
+
+// Run the suite for the backends, thread counts and rank counts of the options, by default the thread counts 1
+// and 3 and every rank count. All processes of MPI_COMM_WORLD must call it. The collector prints every failed
+// check and a summary. Returns the number of failed checks, on every process.
+int verifyBackends(const BenchmarkOptions& options, const int world_size, const int world_rank, const int collector);
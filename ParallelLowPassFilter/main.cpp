@@ -9,12 +9,23 @@
 #include <chrono>
 
 #include "LPF_Sequential.h"
-#include "LPF_openMP.h"
+#include "LPF_OpenMP.h"
 #include "LPF_MPI.h"
+#include "LPF_Hybrid.h"
+#include "LPF_Batch.h"
+#include "LPF_App.h"
+#include "LPF_Benchmark.h"
+#include "LPF_SIMD.h"
+#include "LPF_Stream.h"
+#include "LPF_ImageIO.h"
 
 using namespace cv;
 using namespace std;
 
+#if !defined(_MSC_VER)
+#define scanf_s scanf // The menu only reads numbers, where scanf_s and scanf are the same
+#endif
+
 void compareImage(String image1, String image2, String windowName) { // Compare two images using Paths
     Mat a;
     Mat b = imread(image1, IMREAD_COLOR);
@@ -35,7 +46,9 @@ void compareImageMSE(const Mat& image1, const Mat& image2, String windowName) {
     Mat diff;
 
     absdiff(image1, image2, diff);
-    double mse = mean(diff.mul(diff))[0]; // compute mean squared error
+    diff.convertTo(diff, CV_64F); // square without saturating 8-bit and 16-bit differences
+    Scalar channelMse = mean(diff.mul(diff));
+    double mse = (channelMse[0] + channelMse[1] + channelMse[2] + channelMse[3]) / diff.channels(); // compute mean squared error over all channels
     if (mse > 0) { // if there is a difference
         printf("At %s, Images are different (MSE = %lf)\n", windowName.c_str(), mse);
     }
@@ -45,22 +58,85 @@ void compareImageMSE(const Mat& image1, const Mat& image2, String windowName) {
     fflush(stdout);
 }
 
+void compareImageExact(const Mat& image1, const Mat& image2, String windowName) { // Compare two images value by value
+    Mat diff;
+
+    absdiff(image1, image2, diff);
+    diff = diff.reshape(1); // count every channel value on its own
+    int differences = countNonZero(diff);
+    if (differences > 0) { // integer averages round the same way everywhere, so any difference is a bug
+        double maxDifference;
+        minMaxLoc(diff, nullptr, &maxDifference);
+        printf("At %s, Images are different (%d values, max difference = %lf)\n", windowName.c_str(), differences, maxDifference);
+    }
+    else {
+        printf("At %s, Images are the same\n", windowName.c_str());
+    }
+    fflush(stdout);
+}
+
 void process(const Mat& image, const int& kernal_size, const int& world_size, const int& world_rank, const int& collector) {
 
     Mat MPI_outputImage = mpi::process(image, kernal_size, world_size, world_rank, collector, false);
+    Mat Hybrid_outputImage = hybrid::process(image, kernal_size, world_size, world_rank, collector, omp_get_max_threads(), false);
 
     if (world_rank == collector) {
         Mat Seq_outputImage =  sequential::process(image, kernal_size, false);
         Mat openMP_outputImage = openmp::process(image, kernal_size, world_size, false);
 
-        compareImageMSE(Seq_outputImage, openMP_outputImage, "Seq vs openMP");
-        compareImageMSE(Seq_outputImage, MPI_outputImage, "Seq vs MPI");
-        compareImageMSE(openMP_outputImage, MPI_outputImage, "openMP vs MPI");
+        compareImageExact(Seq_outputImage, openMP_outputImage, "Seq vs openMP");
+        compareImageExact(Seq_outputImage, MPI_outputImage, "Seq vs MPI");
+        compareImageExact(openMP_outputImage, MPI_outputImage, "openMP vs MPI");
+        compareImageExact(Seq_outputImage, Hybrid_outputImage, "Seq vs Hybrid");
 
         waitKey(0);
     }
 }
 
+void processMapped(const String& inputPath, const int& kernal_size, const int& world_size, const int& world_rank, const int& collector) { // Filter a mapped file with every method into mapped output files
+    MappedImage input;
+    int opened = input.open(inputPath) ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &opened, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!opened) {
+        if (world_rank == collector) {
+            printf("Could not map %s\n", inputPath.c_str());
+            fflush(stdout);
+        }
+        return;
+    }
+
+    const char* extension = input.header().format == FORMAT_PFM ? ".pfm" : ".pgm";
+    MappedImage Seq_output, openMP_output, MPI_output;
+    if (world_rank == collector) {
+        Seq_output.create(String("seqImage") + extension, input.header());
+        openMP_output.create(String("OpenMPImage") + extension, input.header());
+        MPI_output.create(String("mpiImage") + extension, input.header());
+
+        auto start_time = chrono::high_resolution_clock::now();
+        seqLowPassFilter(input.mat(), Seq_output.mat(), kernal_size);
+        auto end_time = chrono::high_resolution_clock::now();
+        printf("Mapped Sequential Elapsed time: %lld milliseconds\n", (long long)chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count());
+
+        start_time = chrono::high_resolution_clock::now();
+        openMPLowPassFilter(input.mat(), openMP_output.mat(), kernal_size, world_size);
+        end_time = chrono::high_resolution_clock::now();
+        printf("Mapped OpenMP Elapsed time: %lld milliseconds\n", (long long)chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count());
+        fflush(stdout);
+    }
+
+    auto start_time = chrono::high_resolution_clock::now();
+    MPILowPassFilter(input.mat(), MPI_output.mat(), kernal_size, world_size, world_rank, collector);
+    auto end_time = chrono::high_resolution_clock::now();
+
+    if (world_rank == collector) {
+        printf("Mapped MPI Elapsed time: %lld milliseconds\n", (long long)chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count());
+        fflush(stdout);
+
+        compareImageExact(Seq_output.mat(), openMP_output.mat(), "Mapped Seq vs openMP");
+        compareImageExact(Seq_output.mat(), MPI_output.mat(), "Mapped Seq vs MPI");
+    }
+}
+
 int main(int argc, char** argv) {
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -68,15 +144,6 @@ int main(int argc, char** argv) {
     // Set OPENCV LOG level to ERROR
     utils::logging::setLogLevel(utils::logging::LogLevel::LOG_LEVEL_ERROR);
 
-    Mat image = imread("untitled.png", IMREAD_GRAYSCALE);
-
-    if (image.empty()) {
-        printf("Could not read the image\n");
-        fflush(stdout);
-        MPI_Abort(MPI_COMM_WORLD, 1);
-        return 1;
-    }
-
     // Get the number of processes
     int world_size;
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
@@ -87,10 +154,28 @@ int main(int argc, char** argv) {
 
     const int collector = 0; // The processor that will send the message
 
+    // With command line arguments, run the headless benchmark instead of the interactive menu
+    if (argc > 1) {
+        int result = benchmarkMain(argc, argv, world_size, world_rank, collector);
+        MPI_Finalize();
+        return result;
+    }
+
+    Mat image = imread("untitled.png", IMREAD_UNCHANGED); // keep the channels and the bit depth, every filter handles them
+
+    if (image.empty()) {
+        printf("Could not read the image\n");
+        fflush(stdout);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return 1;
+    }
+
     int method = 4; // The method that will be used to process the image with default value of 4 (all methods)
     int kernal_size = 3; // The size of the kernel with default value of 3
+    const int band_height = 256; // The number of rows the streaming method filters at a time
 
     if (world_rank == collector) {
+        printf("Using %s row kernels\n", simdLevelName(getSIMDLevel()));
         printf("Remember to press ESC on window to continue\n\n");
         fflush(stdout);
     }
@@ -103,7 +188,12 @@ int main(int argc, char** argv) {
         printf("2- OpenMP\n");
         printf("3- MPI\n");
         printf("4- All\n");
-        printf("5- Terminate\n");
+        printf("5- Streaming (untitled.pgm)\n");
+        printf("6- Memory mapped (untitled.pgm)\n");
+        printf("7- MPI-IO (untitled.pgm)\n");
+        printf("8- Hybrid MPI+OpenMP\n");
+        printf("9- Batch (frames directory)\n");
+        printf("10- Terminate\n");
         printf("\nMethod: ");
         fflush(stdout);
 
@@ -124,13 +214,18 @@ int main(int argc, char** argv) {
         MPI_Bcast(&method, 1, MPI_INT, collector, MPI_COMM_WORLD);
 
         switch (method) {
-        case 5:
+        case 10:
             goto exit_loop;
             break;
         case 1:
         case 2:
         case 3:
         case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+        case 9:
             if (world_rank == collector) {
                 do {
                     printf("Enter the kernel size: ");
@@ -172,11 +267,41 @@ int main(int argc, char** argv) {
                 MPI_Bcast(&kernal_size, 1, MPI_INT, collector, MPI_COMM_WORLD);
                 process(image, kernal_size, world_size, world_rank, collector);
                 break;
+            case 5:
+                if (world_rank == collector) {
+                    stream::process("untitled.pgm", "streamImage.pgm", kernal_size, band_height, omp_get_max_threads());
+                }
+                break;
+            case 6:
+                MPI_Bcast(&kernal_size, 1, MPI_INT, collector, MPI_COMM_WORLD);
+                processMapped("untitled.pgm", kernal_size, world_size, world_rank, collector);
+                break;
+            case 7:
+                MPI_Bcast(&kernal_size, 1, MPI_INT, collector, MPI_COMM_WORLD);
+                mpi::processFile("untitled.pgm", "mpiIOImage.pgm", kernal_size, world_size, world_rank, collector);
+                break;
+            case 8:
+                MPI_Bcast(&kernal_size, 1, MPI_INT, collector, MPI_COMM_WORLD);
+                hybrid::process(image, kernal_size, world_size, world_rank, collector, omp_get_max_threads());
+                break;
+            case 9:
+                if (world_rank == collector) {
+                    DirectoryFrameSource source("frames");
+                    ImageSequenceFrameSink sink("batchImage_%06d.png");
+                    if (source.isOpened()) {
+                        batch::process(source, &sink, kernal_size, omp_get_max_threads());
+                    }
+                    else {
+                        printf("Could not find any frames in the frames directory\n");
+                        fflush(stdout);
+                    }
+                }
+                break;
             }
             break;
     default:
         if (world_rank == collector) {
-            printf("The method number must be a number from 1 to 5\n");
+            printf("The method number must be a number from 1 to 10\n");
             fflush(stdout);
         }
 		break;
@@ -192,4 +317,4 @@ int main(int argc, char** argv) {
     // Finalize the MPI environment.
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file